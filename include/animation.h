@@ -0,0 +1,32 @@
+#pragma once
+
+#include "types.h"
+#include <stdbool.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/util/box.h>
+
+// Configuration
+extern int animation_duration;      // milliseconds, 0 disables
+extern int animation_frame_budget;  // microseconds per output frame, 0 is unbounded
+
+// animate a window from the geometry it was last placed at to rect. A first
+// placement fades the window in. Returns true when the toplevel's saved buffer
+// is stretched in place of the client and must be kept, it is released when
+// the animation ends
+bool animation_move(node_t *n, struct wlr_box from, struct wlr_box to);
+
+// fade out a copy of the buffers in content, called before the window's
+// scene tree goes away
+void animation_close(node_t *n, struct wlr_scene_tree *content);
+
+// jump a window's animation to its end state
+void animation_finish(node_t *n);
+
+// drop a window's animation without touching the scene, the node is freed
+void animation_cancel(node_t *n);
+
+// advance animations on the output, called from output_frame
+void animation_tick(struct bwm_output *m);
+
+void animation_output_destroyed(struct bwm_output *m);
+void animation_fini(void);
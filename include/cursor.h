@@ -42,6 +42,8 @@ void handle_pointer_constraint(struct wl_listener *listener, void *data);
 void handle_cursor_request_set_shape(struct wl_listener *listener, void *data);
 
 void begin_interactive(struct bwm_toplevel *toplevel, enum cursor_mode mode, uint32_t edges);
+// flush interactive grab state once per output frame
+void cursor_output_frame(struct bwm_output *output);
 void cursor_init_gestures(void);
 
 void handle_new_virtual_pointer(struct wl_listener *listener, void *data);
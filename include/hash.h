@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// chained hash table mapping a string or integer key to a pointer. Keys may
+// repeat, entries with the same key are kept in insertion order
+struct bwm_hash_entry {
+  struct bwm_hash_entry *next;
+  uint32_t hash;
+  uint32_t id;
+  char *name;
+  void *value;
+};
+
+struct bwm_hash {
+  struct bwm_hash_entry **buckets;
+  size_t bucket_count;
+  size_t count;
+};
+
+uint32_t hash_string(const char *s);
+
+bool hash_insert_name(struct bwm_hash *h, const char *name, void *value);
+// removes the entry for name that points to value
+void hash_remove_name(struct bwm_hash *h, const char *name, void *value);
+void *hash_lookup_name(struct bwm_hash *h, const char *name);
+// walk every entry for name, pass NULL to start
+struct bwm_hash_entry *hash_next_name(struct bwm_hash *h, const char *name,
+                                      struct bwm_hash_entry *prev);
+
+bool hash_insert_id(struct bwm_hash *h, uint32_t id, void *value);
+void hash_remove_id(struct bwm_hash *h, uint32_t id, void *value);
+void *hash_lookup_id(struct bwm_hash *h, uint32_t id);
+
+void hash_fini(struct bwm_hash *h);
@@ -10,6 +10,7 @@
 
 struct bwm_blur_output_ctx;
 struct desktop_t;
+struct wlr_ext_workspace_group_handle_v1;
 
 enum scale_filter_mode {
 	SCALE_FILTER_AUTO,
@@ -59,6 +60,7 @@ struct bwm_output {
   struct desktop_t *desk;
   struct desktop_t *desk_head;
   struct desktop_t *desk_tail;
+  struct wlr_ext_workspace_group_handle_v1 *workspace_group;
   struct bwm_output *prev;
   struct bwm_output *next;
 };
@@ -67,6 +69,9 @@ void handle_new_output(struct wl_listener *listener, void *data);
 void output_enable(struct bwm_output *output);
 void output_disable(struct bwm_output *output);
 void output_destroy(struct bwm_output *output);
+void output_rename(struct bwm_output *output, const char *name);
+struct bwm_output *find_output_by_name(const char *name);
+void output_fini(void);
 struct bwm_output *output_from_wlr_output(struct wlr_output *wlr_output);
 struct bwm_output *output_get_in_direction(struct bwm_output *reference, uint32_t direction);
 void output_update_usable_area(struct bwm_output *output);
@@ -74,3 +79,5 @@ void output_set_scale_filter(struct bwm_output *output, enum scale_filter_mode m
 void output_get_identifier(char *identifier, size_t len, struct bwm_output *output);
 void output_update_scale(struct bwm_output *output, float scale);
 struct bwm_output *output_get_valid(void);
+void output_append_desktop(struct bwm_output *output, struct desktop_t *d);
+void output_unlink_desktop(struct bwm_output *output, struct desktop_t *d);
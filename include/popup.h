@@ -14,5 +14,8 @@ struct bwm_popup {
   struct wl_listener destroy;
 };
 
+// number of live xdg popups, popups can overlap neighboring windows
+extern int popup_count;
+
 void handle_new_xdg_popup(struct wl_listener *listener, void *data);
 void handle_new_layer_popup(struct wl_listener *listener, void *data);
@@ -12,6 +12,7 @@ extern bool scroller_prefer_center;
 extern bool scroller_prefer_overspread;
 extern bool scroller_ignore_proportion_single;
 extern bool edge_scroller_pointer_focus;
+extern int scroller_animation_duration;
 
 // Proportion presets
 extern float *scroller_proportion_preset;
@@ -41,3 +42,10 @@ bool scroller_focus_down(desktop_t *d);
 bool scroller_focus_up(desktop_t *d);
 
 void scroller_apply_client_rules(client_t *c, float rule_proportion, float rule_proportion_single);
+
+// advance viewport animations on the output, called from output_frame
+void scroller_animate(struct bwm_output *m);
+
+// hide columns culled and start a slide queued by scroller_arrange, called
+// when its transaction applies
+void scroller_apply_scroll(desktop_t *d);
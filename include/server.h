@@ -156,6 +156,7 @@ struct bwm_server {
   double grab_x, grab_y;
   struct wlr_box grab_geobox;
   uint32_t resize_edges;
+  bool grab_pending;  // cursor moved since last frame during a grab
   uint32_t cursor_buttons;
   bool focus_from_click;
 
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "types.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <wlr/util/box.h>
+
+// visible window geometry, indexed for directional queries
+struct bwm_spatial_entry {
+  node_t *node;
+  struct bwm_output *output;
+  struct wlr_box box;
+};
+
+// mark the index stale, it is rebuilt on the next query. Also called
+// whenever the stacking of visible surfaces may have changed
+void spatial_invalidate(void);
+
+// bumped by every spatial_invalidate, lets callers cache hit-tests
+uint32_t spatial_generation(void);
+
+// on-screen geometry of a window
+struct wlr_box spatial_node_box(node_t *n);
+
+// nearest visible window from n in dir, on any output, tiled or floating
+node_t *spatial_nearest(node_t *n, direction_t dir, bool tiled_only,
+                        struct bwm_output **out_output);
+
+// tiled window whose frame contains the layout point, tiled windows never
+// overlap so there is at most one
+node_t *spatial_tiled_at(double lx, double ly);
+
+void spatial_fini(void);
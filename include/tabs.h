@@ -23,7 +23,13 @@ struct bwm_tab_bar {
   struct wlr_scene_rect *bg;
   struct bwm_tab_entry *entries;
   size_t entry_count;
+  size_t entry_capacity;
   struct wlr_box rect;
+  bool dirty;
+  // leaf drawn as active, focus changes recolor only it and the new one
+  node_t *active;
+  size_t active_index;
+  bool recolor;
 };
 
 extern float color_bar_bg[4];
@@ -39,6 +45,9 @@ void tabs_create(node_t *n);
 void tabs_destroy(node_t *n);
 
 void tabs_rebuild(node_t *n);
+// defer the rebuild to the next tabs_arrange, repeated marks coalesce
+void tabs_mark_dirty(node_t *n);
+void tabs_mark_ancestors_dirty(node_t *n);
 void tabs_arrange(node_t *n, struct wlr_box rect);
 void tabs_update_focus(node_t *n, node_t *focus);
 void tabs_update_label_for_leaf(node_t *leaf);
@@ -27,3 +27,6 @@ void bwm_text_node_set_text(struct bwm_text_node *node, const char *text);
 void bwm_text_node_set_max_width(struct bwm_text_node *node, int max_width);
 
 int bwm_text_node_default_height(void);
+
+// drop the shared font and the layout and label caches
+void text_fini(void);
@@ -13,7 +13,8 @@ struct bwm_toplevel {
   struct wlr_xdg_toplevel *xdg_toplevel;
   struct wlr_scene_tree *scene_tree;      // Parent container
   struct wlr_scene_tree *content_tree;    // XDG surface content
-  struct wlr_scene_tree *saved_surface_tree;  // Saved buffer snapshot
+  struct wlr_scene_tree *saved_surface_tree;  // Saved buffer snapshot, NULL when inactive
+  struct wlr_scene_tree *snapshot_tree;       // Reused backing tree for saved_surface_tree
 
   struct wlr_scene_buffer *blur_node;
   struct wlr_scene_buffer *mica_node;
@@ -58,6 +59,8 @@ struct bwm_toplevel {
 
   bool mapped;
   bool configured;
+  bool title_dirty;
+  bool app_id_dirty;
   bool client_maximized;
 
   // tearing control
@@ -98,6 +101,11 @@ bool toplevel_is_ready(struct bwm_toplevel *toplevel);
 void update_foreign_toplevel_state(struct bwm_toplevel *toplevel);
 void toplevel_center_and_clip_surface(struct bwm_toplevel *toplevel);
 
+// title and app_id changes are pushed to foreign toplevel handles and tab
+// labels once per output frame
+void toplevel_schedule_names(node_t *n);
+void toplevel_flush_names(void);
+
 // buffer saving for transactions
 void toplevel_save_buffer(struct bwm_toplevel *toplevel);
 void toplevel_remove_saved_buffer(struct bwm_toplevel *toplevel);
@@ -7,10 +7,23 @@
 #include <wlr/util/box.h>
 #include <wlr/types/wlr_scene.h>
 
+#define TXN_APP_ID_LEN 64
+#define TXN_RECORD_CLIENTS 8
+
 // forward declarations
 struct node_t;
 struct bwm_toplevel;
 
+// apply ready instructions before the slowest client acks
+extern bool transaction_partial_apply;
+
+// one client's configure-to-ack latency within a transaction
+struct bwm_client_ack {
+  char app_id[TXN_APP_ID_LEN];
+  double ms;  // time to ack, or time waited when timed out
+  bool timed_out;
+};
+
 struct bwm_transaction_inst {
   struct bwm_transaction *transaction;
   struct node_t *node;
@@ -29,6 +42,7 @@ struct bwm_transaction_inst {
   uint32_t serial;
   bool waiting;
   bool server_request;
+  bool applied;  // applied early by partial apply
 
   // scene tree snapshot during alive state
   struct wlr_scene_tree *scene_tree;
@@ -39,7 +53,32 @@ struct bwm_transaction {
   struct wl_list instructions;
   size_t num_waiting;
   size_t num_configures;
+  size_t num_timeouts;
+  struct timespec commit_time;
+
+  // clients waited on, for stats
+  struct bwm_client_ack acks[TXN_RECORD_CLIENTS];
+  size_t num_acks;
+};
+
+// completed transaction, kept in a bounded ring for ipc queries
+struct bwm_transaction_record {
   struct timespec commit_time;
+  double duration_ms;
+  size_t num_instructions;
+  size_t num_configures;
+  size_t num_timeouts;
+  struct bwm_client_ack acks[TXN_RECORD_CLIENTS];
+  size_t num_acks;
+};
+
+// aggregated configure-to-ack latency per app_id
+struct bwm_client_latency {
+  char app_id[TXN_APP_ID_LEN];
+  size_t samples;
+  double total_ms;
+  double max_ms;
+  size_t timeouts;
 };
 
 /**
@@ -97,3 +136,10 @@ void transaction_add_dirty_node(struct node_t *node);
  * transaction can proceed without waiting for a destroyed client.
  */
 void transaction_notify_view_unmapped(struct node_t *node);
+
+/**
+ * Write per-app_id latency stats and recent transaction records to buf
+ * as JSON. Records that do not fit in size are dropped, oldest first, so
+ * the output is always complete JSON. Returns the number of bytes written.
+ */
+size_t transaction_stats_format(char *buf, size_t size);
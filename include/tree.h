@@ -9,7 +9,18 @@
 // node creation and destruction
 node_t *make_node(uint32_t id);
 client_t *make_client(void);
+desktop_t *make_desktop(const char *name);
 void free_node(node_t *n);
+void free_desktop(desktop_t *d);
+void tree_fini(void);
+
+// hashed lookups, desktop names are only unique per output so m narrows
+// the match, NULL takes the first desktop with that name in output order
+void desktop_rename(desktop_t *d, const char *name);
+void desktop_index(desktop_t *d);
+void desktop_unindex(desktop_t *d);
+desktop_t *desktop_from_name(struct bwm_output *m, const char *name);
+node_t *node_from_id(uint32_t id);
 
 // Tree layout
 void arrange(struct bwm_output *m, desktop_t *d, bool use_transaction);
@@ -22,6 +33,17 @@ node_t *insert_node(desktop_t *d, node_t *n, node_t *f);
 void remove_node(desktop_t *d, node_t *n);
 void kill_node(desktop_t *d, node_t *n);
 
+// per-desktop scene layers, each desktop owns one subtree below the tile,
+// float and fullscreen layers so switching desktops only toggles those
+struct wlr_scene_tree *desktop_layer(desktop_t *d, struct wlr_scene_tree *layer);
+bool desktop_is_visible(desktop_t *d);
+void desktop_set_visible(desktop_t *d, bool visible);
+void desktop_destroy_layers(desktop_t *d);
+void output_sync_desktops(struct bwm_output *m);
+void desktops_mark_dirty(struct bwm_output *m);
+void node_reparent_scene(node_t *n);
+bool node_on_screen(node_t *n);
+
 // node queries
 bool is_leaf(node_t *n);
 bool is_tiled(client_t *c);
@@ -29,6 +51,7 @@ bool is_floating(client_t *c);
 bool is_first_child(node_t *n);
 bool is_second_child(node_t *n);
 unsigned int clients_count_in(node_t *n);
+void update_clients_count(node_t *n);
 int tiled_count(node_t *n, bool include_receptacles);
 node_t *brother_tree(node_t *n);
 node_t *first_extrema(node_t *n);
@@ -85,6 +108,10 @@ void update_borders(struct wlr_scene_tree *border_tree, struct wlr_scene_rect *r
                     struct wlr_box geo, unsigned int bw);
 void update_border_colors(struct wlr_scene_tree *border_tree, struct wlr_scene_rect *rects[4],
                           client_t *client);
+void node_update_border_colors(node_t *n);
+void desktop_update_border_colors(desktop_t *d);
+void update_focus_borders(desktop_t *d);
+void parse_border_colors(void);
 
 // macros for state checking
 #define IS_TILED(c) (is_tiled(c))
@@ -68,6 +68,7 @@ typedef struct client_t {
   unsigned int border_width;
   bool urgent;
   bool shown;
+  bool culled;  // scrolled out of the scroller viewport
   client_state_t state;
   client_state_t last_state;
   stack_layer_t layer;
@@ -75,8 +76,10 @@ typedef struct client_t {
   struct wlr_box floating_rectangle;
   struct wlr_box tiled_rectangle;
   struct wlr_box committed_tiled_rectangle;
+  struct wlr_box applied_rectangle;  // geometry last placed in the scene
   struct bwm_toplevel *toplevel;
   struct bwm_xwayland_view *xwayland_view;
+  struct node_t *node;  // leaf holding this client
 
   // Scroller layout properties
   float scroller_proportion;
@@ -115,6 +118,7 @@ typedef struct node_t {
   struct node_t *first_child;
   struct node_t *second_child;
   struct node_t *parent;
+  unsigned int clients;  // clients in this subtree, see update_clients_count
   client_t *client;
   struct bwm_output *output;
   struct desktop_t *desktop;
@@ -157,6 +161,37 @@ typedef struct desktop_t {
   int window_gap;
   unsigned int border_width;
   struct bwm_output *output;
+
+  // scene subtrees holding this desktop's windows, see desktop_layer
+  struct wlr_scene_tree *tile_tree;
+  struct wlr_scene_tree *float_tree;
+  struct wlr_scene_tree *full_tree;
+  // layout inputs changed since the last arrange, checked when shown again
+  bool layout_dirty;
+  struct wlr_ext_workspace_handle_v1 *workspace;
+
+  // focus_node bookkeeping so focus changes only touch two windows
+  node_t *border_focus;   // last node painted with the focused color
+  bool border_active;     // unfocused borders use the active color
+  layout_t border_layout;
+  bool shown_synced;      // client visibility matches shown_layout
+  layout_t shown_layout;
+
+  // scroller column heads in leaf order, storage kept between arranges
+  node_t **columns;
+  int column_count;
+  int column_capacity;
+
+  // scroller viewport animation, the tile layer is offset by scroll_from
+  // at scroll_start_msec and eased back to 0. scroll_pending is the
+  // distance queued by arranges whose transaction has not applied yet
+  bool scrolling;
+  double scroll_from;
+  int64_t scroll_start_msec;
+  int scroll_pending;
+  bool scroll_queued;
+  // columns culled by an arrange are hidden when its transaction applies
+  bool cull_pending;
 } desktop_t;
 
 typedef struct {
@@ -190,6 +225,11 @@ extern char normal_border_color[16];
 extern char active_border_color[16];
 extern char focused_border_color[16];
 extern char presel_feedback_color[16];
+// the colors above as rgba, kept in sync by parse_border_colors
+extern float normal_border_rgba[4];
+extern float active_border_rgba[4];
+extern float focused_border_rgba[4];
+extern float presel_feedback_rgba[4];
 
 // global state
 extern struct bwm_output *mon;
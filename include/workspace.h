@@ -3,13 +3,30 @@
 #include <wlr/types/wlr_ext_workspace_v1.h>
 #include <stdbool.h>
 
+struct bwm_output;
+struct desktop_t;
+
 void workspace_init(void);
 void workspace_fini(void);
+
+// every desktop has one workspace handle for its whole life, and every
+// output one group; only their state is updated afterwards
 void workspace_sync(void);
-void workspace_create_desktop(const char *name);
+void workspace_output_add(struct bwm_output *m);
+void workspace_output_remove(struct bwm_output *m);
+void workspace_desktop_add(struct desktop_t *d);
+void workspace_desktop_remove(struct desktop_t *d);
+void workspace_desktop_update(struct desktop_t *d);
+
+// desktops that still own windows, tiled or floating, must not be freed
+bool desktop_has_windows(struct desktop_t *d);
+
+// an unplugged output hands its desktops to another output, or parks them
+// until the next output is added when it was the last one
+void workspace_output_evacuate(struct bwm_output *m);
+bool workspace_adopt_parked(struct bwm_output *m);
+
 void workspace_switch_to_desktop(const char *name);
 void workspace_switch_to_desktop_by_index(int index);
-struct wlr_ext_workspace_handle_v1 *workspace_get_active(void);
 
-struct desktop_t;
 struct desktop_t *find_desktop_by_name(const char *name);
@@ -41,6 +41,7 @@ struct bwm_xwayland_view {
 	struct wlr_scene_rect *border_rects[4];
 
 	bool mapped;
+	bool names_dirty;
 	struct wlr_box geometry;
 
 	struct wlr_ext_foreign_toplevel_handle_v1 *ext_foreign_toplevel;
@@ -92,4 +93,5 @@ void handle_xwayland_ready(struct wl_listener *listener, void *data);
 void handle_xwayland_surface(struct wl_listener *listener, void *data);
 
 void xwayland_view_close(struct bwm_xwayland_view *xwayland_view);
+void xwayland_flush_names(void);
 void xwayland_view_set_activated(struct bwm_xwayland_view *xwayland_view, bool activated);
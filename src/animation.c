@@ -0,0 +1,426 @@
+#include "animation.h"
+#include "server.h"
+#include "toplevel.h"
+#include "tree.h"
+#include "output.h"
+#include "spatial.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wlr/types/wlr_alpha_modifier_v1.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+
+// saved buffers stretched per window, windows with more are only moved
+#define ANIM_SNAPSHOT_BUFFERS 8
+
+int animation_duration = 0;
+int animation_frame_budget = 2000;
+
+struct window_animation {
+  node_t *node;                  // NULL once the window is closed
+  struct wlr_scene_tree *ghost;  // copied buffers of a closed window
+  struct bwm_output *output;
+  struct wlr_box from, to;
+  float from_alpha, to_alpha;
+  int64_t start_usec;
+
+  // saved buffer geometry at the from size, stretched towards the to size
+  bool stretch;
+  size_t box_count;
+  struct wlr_box boxes[ANIM_SNAPSHOT_BUFFERS];
+};
+
+static struct {
+  struct window_animation *items;
+  size_t count;
+  size_t capacity;
+} anim_state = {0};
+
+static int64_t now_usec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static struct window_animation *find(node_t *n) {
+  for (size_t i = 0; i < anim_state.count; i++)
+    if (anim_state.items[i].node == n)
+      return &anim_state.items[i];
+  return NULL;
+}
+
+static struct window_animation *start(node_t *n, struct bwm_output *m) {
+  if (anim_state.count >= anim_state.capacity) {
+    size_t cap = anim_state.capacity == 0 ? 8 : anim_state.capacity * 2;
+    struct window_animation *items = realloc(anim_state.items, cap * sizeof(*items));
+    if (items == NULL)
+      return NULL;
+    anim_state.items = items;
+    anim_state.capacity = cap;
+  }
+
+  struct window_animation *a = &anim_state.items[anim_state.count++];
+  memset(a, 0, sizeof(*a));
+  a->node = n;
+  a->output = m;
+  a->from_alpha = 1.0f;
+  a->to_alpha = 1.0f;
+  a->start_usec = now_usec();
+
+  if (m->wlr_output)
+    wlr_output_schedule_frame(m->wlr_output);
+  return a;
+}
+
+// order is irrelevant, the last entry fills the gap
+static void remove_animation(struct window_animation *a) {
+  *a = anim_state.items[--anim_state.count];
+}
+
+static bool node_alive(node_t *n) {
+  return n != NULL && !n->destroying && n->client != NULL &&
+         client_get_scene_tree(n->client) != NULL;
+}
+
+static double progress(struct window_animation *a, int64_t now) {
+  if (animation_duration <= 0)
+    return 1.0;
+  double t = (double)(now - a->start_usec) / (animation_duration * 1000.0);
+  return t < 0.0 ? 0.0 : t;
+}
+
+// ease-out cubic, fast start and a soft landing
+static double ease(double t) {
+  return t >= 1.0 ? 1.0 : 1.0 - pow(1.0 - t, 3);
+}
+
+static int lerp(int a, int b, double e) {
+  return a + (int)lround((b - a) * e);
+}
+
+static struct wlr_box lerp_box(struct wlr_box a, struct wlr_box b, double e) {
+  return (struct wlr_box){
+    .x = lerp(a.x, b.x, e),
+    .y = lerp(a.y, b.y, e),
+    .width = lerp(a.width, b.width, e),
+    .height = lerp(a.height, b.height, e),
+  };
+}
+
+// surfaces carry their alpha-modifier opacity, everything else is opaque
+static float base_opacity(struct wlr_scene_buffer *buffer) {
+  struct wlr_scene_surface *scene_surface = wlr_scene_surface_try_from_buffer(buffer);
+  if (scene_surface) {
+    const struct wlr_alpha_modifier_surface_v1_state *state =
+      wlr_alpha_modifier_v1_get_surface_state(scene_surface->surface);
+    if (state)
+      return (float)state->multiplier;
+  }
+  return 1.0f;
+}
+
+static void set_opacity_iterator(struct wlr_scene_buffer *buffer,
+                                 int sx, int sy, void *data) {
+  (void)sx;
+  (void)sy;
+  wlr_scene_buffer_set_opacity(buffer, base_opacity(buffer) * *(float *)data);
+}
+
+// border rects are not buffers, they fade through their color
+static void fade_borders(client_t *c, float alpha) {
+  struct wlr_scene_tree *border_tree;
+  struct wlr_scene_rect **rects;
+  if (c->toplevel) {
+    border_tree = c->toplevel->border_tree;
+    rects = c->toplevel->border_rects;
+  } else if (c->xwayland_view) {
+    border_tree = c->xwayland_view->border_tree;
+    rects = c->xwayland_view->border_rects;
+  } else {
+    return;
+  }
+
+  // rounded borders are drawn into a buffer and fade with the rest
+  if (border_tree == NULL || c->border_radius > 0.0f)
+    return;
+
+  update_border_colors(border_tree, rects, c);
+  for (int i = 0; i < 4; i++) {
+    if (rects[i] == NULL)
+      continue;
+    float color[4];
+    for (int k = 0; k < 4; k++)
+      color[k] = rects[i]->color[k] * alpha;
+    wlr_scene_rect_set_color(rects[i], color);
+  }
+}
+
+// remember where the saved buffers sit at the from size
+static bool capture_snapshot(struct window_animation *a, struct wlr_scene_tree *saved) {
+  a->box_count = 0;
+  struct wlr_scene_node *child;
+  wl_list_for_each(child, &saved->children, link) {
+    if (!child->enabled)
+      continue;
+    struct wlr_scene_buffer *sbuf = wlr_scene_buffer_from_node(child);
+    if (a->box_count >= ANIM_SNAPSHOT_BUFFERS || sbuf->dst_width <= 0 ||
+        sbuf->dst_height <= 0)
+      return false;
+    a->boxes[a->box_count++] = (struct wlr_box){
+      child->x, child->y, sbuf->dst_width, sbuf->dst_height,
+    };
+  }
+  return a->box_count > 0;
+}
+
+static void stretch_snapshot(struct window_animation *a, struct bwm_toplevel *toplevel,
+                             struct wlr_box box) {
+  struct wlr_scene_tree *saved = toplevel->saved_surface_tree;
+  if (saved == NULL)
+    return;
+
+  double sx = (double)box.width / a->from.width;
+  double sy = (double)box.height / a->from.height;
+  size_t i = 0;
+  struct wlr_scene_node *child;
+  wl_list_for_each(child, &saved->children, link) {
+    if (!child->enabled || i >= a->box_count)
+      continue;
+    struct wlr_box *b = &a->boxes[i++];
+    int w = (int)lround(b->width * sx), h = (int)lround(b->height * sy);
+    wlr_scene_node_set_position(child, (int)lround(b->x * sx), (int)lround(b->y * sy));
+    wlr_scene_buffer_set_dest_size(wlr_scene_buffer_from_node(child),
+      w > 0 ? w : 1, h > 0 ? h : 1);
+  }
+
+  client_t *c = a->node->client;
+  if (c->border_width == 0)
+    return;
+  unsigned int bw = c->border_width;
+  const struct wlr_box geo = {0, 0, box.width, box.height};
+  update_borders(toplevel->border_tree, toplevel->border_rects, geo, bw);
+  if (toplevel->border_shader_node)
+    wlr_scene_buffer_set_dest_size(toplevel->border_shader_node,
+      box.width + 2 * (int)bw, box.height + 2 * (int)bw);
+}
+
+// only scene state changes here, clients never see a configure
+static void place(struct window_animation *a, double e) {
+  float alpha = a->from_alpha + (a->to_alpha - a->from_alpha) * (float)e;
+
+  if (a->ghost) {
+    wlr_scene_node_for_each_buffer(&a->ghost->node, set_opacity_iterator, &alpha);
+    return;
+  }
+
+  client_t *c = a->node->client;
+  struct wlr_scene_tree *tree = client_get_scene_tree(c);
+  struct wlr_box box = lerp_box(a->from, a->to, e);
+  wlr_scene_node_set_position(&tree->node, box.x, box.y);
+
+  if (a->stretch && c->toplevel)
+    stretch_snapshot(a, c->toplevel, box);
+
+  if (a->from_alpha != 1.0f || a->to_alpha != 1.0f) {
+    wlr_scene_node_for_each_buffer(&tree->node, set_opacity_iterator, &alpha);
+    fade_borders(c, alpha);
+  }
+
+  // surfaces moved under the pointer, cached hover hits are stale
+  if (!wlr_box_equal(&a->from, &a->to))
+    spatial_invalidate();
+}
+
+static void finish(struct window_animation *a) {
+  if (a->ghost) {
+    wlr_scene_node_destroy(&a->ghost->node);
+  } else if (node_alive(a->node)) {
+    place(a, 1.0);
+    struct bwm_toplevel *toplevel = a->node->client->toplevel;
+    if (a->stretch && toplevel) {
+      toplevel_remove_saved_buffer(toplevel);
+      if (a->node->client->border_radius > 0.0f)
+        toplevel->border_dirty = true;
+    }
+  }
+  remove_animation(a);
+}
+
+bool animation_move(node_t *n, struct wlr_box from, struct wlr_box to) {
+  if (n == NULL || n->client == NULL)
+    return false;
+
+  // pick up from wherever a running animation has got to
+  float alpha = 1.0f;
+  struct window_animation *running = find(n);
+  if (running) {
+    double e = ease(progress(running, now_usec()));
+    struct wlr_box at = lerp_box(running->from, running->to, e);
+    from.x = at.x;
+    from.y = at.y;
+    alpha = running->from_alpha + (running->to_alpha - running->from_alpha) * (float)e;
+    finish(running);
+  }
+
+  client_t *c = n->client;
+  struct wlr_scene_tree *tree = client_get_scene_tree(c);
+  if (animation_duration <= 0 || tree == NULL || !tree->node.enabled ||
+      c->culled || !node_on_screen(n) || n->output == NULL)
+    return false;
+
+  // the scroller slides its own viewport and drags are followed directly
+  bool scroller_tile = n->desktop && n->desktop->layout == LAYOUT_SCROLLER && IS_TILED(c);
+  bool dragging = server.cursor_mode != CURSOR_PASSTHROUGH;
+
+  // a first placement fades in where it lands
+  if (wlr_box_empty(&from)) {
+    from = to;
+    alpha = 0.0f;
+  } else if (scroller_tile || dragging) {
+    from = to;
+  }
+
+  struct window_animation *a = start(n, n->output);
+  if (a == NULL)
+    return false;
+  a->from = from;
+  a->to = to;
+  a->from_alpha = alpha;
+
+  struct wlr_scene_tree *saved = c->toplevel ? c->toplevel->saved_surface_tree : NULL;
+  if ((from.width != to.width || from.height != to.height) && saved)
+    a->stretch = capture_snapshot(a, saved);
+  if (!a->stretch) {
+    a->from.width = to.width;
+    a->from.height = to.height;
+  }
+
+  if (wlr_box_equal(&a->from, &a->to) && alpha >= 1.0f) {
+    remove_animation(a);
+    return false;
+  }
+
+  place(a, 0.0);
+  return a->stretch;
+}
+
+static void copy_buffer_iterator(struct wlr_scene_buffer *buffer,
+                                 int sx, int sy, void *data) {
+  struct wlr_scene_tree *ghost = data;
+  if (!buffer->buffer)
+    return;
+
+  struct wlr_scene_buffer *copy = wlr_scene_buffer_create(ghost, buffer->buffer);
+  if (!copy)
+    return;
+  wlr_scene_buffer_set_dest_size(copy, buffer->dst_width, buffer->dst_height);
+  wlr_scene_buffer_set_source_box(copy, &buffer->src_box);
+  wlr_scene_buffer_set_transform(copy, buffer->transform);
+  wlr_scene_node_set_position(&copy->node, sx, sy);
+}
+
+void animation_close(node_t *n, struct wlr_scene_tree *content) {
+  if (n == NULL || content == NULL)
+    return;
+
+  animation_finish(n);
+
+  struct wlr_scene_tree *tree = n->client ? client_get_scene_tree(n->client) : NULL;
+  if (animation_duration <= 0 || tree == NULL || !tree->node.enabled ||
+      !node_on_screen(n) || n->output == NULL)
+    return;
+
+  // the copies hold their own buffer references, so they outlive the client
+  struct wlr_scene_tree *ghost = wlr_scene_tree_create(tree->node.parent);
+  if (ghost == NULL)
+    return;
+  wlr_scene_node_set_position(&ghost->node, tree->node.x, tree->node.y);
+  wlr_scene_node_place_above(&ghost->node, &tree->node);
+  wlr_scene_node_for_each_buffer(&content->node, copy_buffer_iterator, ghost);
+
+  if (wl_list_empty(&ghost->children)) {
+    wlr_scene_node_destroy(&ghost->node);
+    return;
+  }
+
+  struct window_animation *a = start(NULL, n->output);
+  if (a == NULL) {
+    wlr_scene_node_destroy(&ghost->node);
+    return;
+  }
+  a->ghost = ghost;
+  a->to_alpha = 0.0f;
+}
+
+void animation_finish(node_t *n) {
+  struct window_animation *a = n ? find(n) : NULL;
+  if (a)
+    finish(a);
+}
+
+void animation_cancel(node_t *n) {
+  struct window_animation *a = n ? find(n) : NULL;
+  if (a)
+    remove_animation(a);
+}
+
+void animation_tick(struct bwm_output *m) {
+  int64_t now = now_usec();
+  bool over_budget = false;
+  bool pending = false;
+
+  size_t i = 0;
+  while (i < anim_state.count) {
+    struct window_animation *a = &anim_state.items[i];
+    if (a->output != m) {
+      i++;
+      continue;
+    }
+
+    if (!a->ghost && !node_alive(a->node)) {
+      remove_animation(a);
+      continue;
+    }
+
+    // past the budget the rest jump to their end, dropping animation
+    // frames rather than output frames
+    double t = over_budget ? 1.0 : progress(a, now);
+    if (t >= 1.0) {
+      finish(a);
+      continue;
+    }
+
+    place(a, ease(t));
+    pending = true;
+    i++;
+
+    if (!over_budget && animation_frame_budget > 0 &&
+        now_usec() - now > animation_frame_budget) {
+      wlr_log(WLR_DEBUG, "animation: frame budget exceeded on %s, finishing early",
+              m->wlr_output ? m->wlr_output->name : "output");
+      over_budget = true;
+    }
+  }
+
+  if (pending && m->wlr_output)
+    wlr_output_schedule_frame(m->wlr_output);
+}
+
+void animation_output_destroyed(struct bwm_output *m) {
+  size_t i = 0;
+  while (i < anim_state.count) {
+    if (anim_state.items[i].output == m)
+      finish(&anim_state.items[i]);
+    else
+      i++;
+  }
+}
+
+void animation_fini(void) {
+  free(anim_state.items);
+  anim_state.items = NULL;
+  anim_state.count = 0;
+  anim_state.capacity = 0;
+}
@@ -3,6 +3,7 @@
 #include "output.h"
 #include "toplevel.h"
 #include "layer.h"
+#include "tree.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -1063,7 +1064,7 @@ static bool rebuild_live_blur(struct bwm_output *output,
   struct bwm_toplevel *tl;
   wl_list_for_each(tl, &server.toplevels, link) {
     if (!tl->blur_node || !tl->node || !tl->node->client) continue;
-    if (!tl->node->client->shown) continue;
+    if (!node_on_screen(tl->node)) continue;
     if (!tl->node->output || tl->node->output != output) continue;
 
     GLuint src = capture_bg_to_tex1(output, ctx, scene_output, false,
@@ -1249,7 +1250,7 @@ static bool rebuild_live_acrylic(struct bwm_output *output,
   struct bwm_toplevel *tl;
   wl_list_for_each(tl, &server.toplevels, link) {
     if (!tl->acrylic_node || !tl->node || !tl->node->client) continue;
-    if (!tl->node->client->shown) continue;
+    if (!node_on_screen(tl->node)) continue;
     if (!tl->node->output || tl->node->output != output) continue;
 
     GLuint src = capture_bg_to_tex1(output, ctx, scene_output, false,
@@ -1510,7 +1511,7 @@ static bool rebuild_corner_masks(struct bwm_output *output,
   struct bwm_toplevel *tl;
   wl_list_for_each(tl, &server.toplevels, link) {
     if (!tl->corner_mask_node || !tl->node || !tl->node->client) continue;
-    if (!tl->node->client->shown) continue;
+    if (!node_on_screen(tl->node)) continue;
     if (!tl->node->output || tl->node->output != output) continue;
 
     client_t *c = tl->node->client;
@@ -1789,7 +1790,7 @@ void blur_output_frame(struct bwm_output *output, struct wlr_scene_output *scene
     bool any_blur = false;
     struct bwm_toplevel *tl;
     wl_list_for_each(tl, &server.toplevels, link) {
-      if (tl->blur_node && tl->node && tl->node->client && tl->node->client->shown &&
+      if (tl->blur_node && node_on_screen(tl->node) &&
           tl->node->output && tl->node->output == output) {
         any_blur = true;
         break;
@@ -1818,7 +1819,7 @@ void blur_output_frame(struct bwm_output *output, struct wlr_scene_output *scene
     bool any_acrylic = false;
     struct bwm_toplevel *tl;
     wl_list_for_each(tl, &server.toplevels, link) {
-      if (tl->acrylic_node && tl->node && tl->node->client && tl->node->client->shown &&
+      if (tl->acrylic_node && node_on_screen(tl->node) &&
           tl->node->output && tl->node->output == output) {
         any_acrylic = true;
         break;
@@ -1841,7 +1842,7 @@ void blur_output_frame(struct bwm_output *output, struct wlr_scene_output *scene
     struct bwm_toplevel *tl;
     wl_list_for_each(tl, &server.toplevels, link) {
       if (!tl->border_dirty) continue;
-      if (!tl->node || !tl->node->client || !tl->node->client->shown) continue;
+      if (!node_on_screen(tl->node)) continue;
       if (!tl->node->output || tl->node->output != output) continue;
       client_t *c = tl->node->client;
       if (c->border_radius <= 0.0f) { tl->border_dirty = false; continue; }
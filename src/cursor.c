@@ -12,6 +12,9 @@
 #include "config.h"
 #include "xwayland.h"
 #include "output.h"
+#include "spatial.h"
+#include "popup.h"
+#include "animation.h"
 #include <linux/input-event-codes.h>
 #include <math.h>
 #include <stdlib.h>
@@ -20,6 +23,7 @@
 #include <wayland-util.h>
 #include <wlr/backend.h>
 #include <wlr/types/wlr_cursor.h>
+#include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_xcursor_manager.h>
 #include <wlr/types/wlr_seat.h>
 #include <wlr/types/wlr_pointer.h>
@@ -42,16 +46,23 @@ extern submap_t *active_submap;
 extern bool keybind_matches(keybind_t *kb, uint32_t modifiers, xkb_keysym_t keysym, uint32_t keycode);
 extern void execute_keybind(keybind_t *kb);
 extern bool handle_keybind_raw(uint32_t modifiers, uint32_t keycode, bool pressed);
-extern bool gapless_monocle;
 
 static void cursor_constrain(struct wlr_pointer_constraint_v1 *constraint);
 
+// last surface found under the pointer
+static struct {
+  struct wlr_surface *surface;
+  node_t *node;
+  uint32_t node_id;  // guards against node reuse after free
+  double x, y;  // surface origin in layout coords
+  uint32_t generation;
+} hover = {0};
+
+static void flush_cursor_grab(void);
+
 static void reset_cursor_mode(void) {
-  if (server.tiled_resize_node) {
-    node_t *node = server.tiled_resize_node;
-    if (node->output && node->desktop)
-      arrange(node->output, node->desktop, true);
-  }
+  // apply the last sampled position before releasing the grab
+  flush_cursor_grab();
 
   server.cursor_mode = CURSOR_PASSTHROUGH;
   server.grabbed_toplevel = NULL;
@@ -59,13 +70,37 @@ static void reset_cursor_mode(void) {
   server.tiled_resize_node = NULL;
   server.tiled_resize_parent_vertical = NULL;
   server.tiled_resize_parent_horizontal = NULL;
+  server.grab_pending = false;
+}
+
+// same as wlr_scene_node_at on the whole scene, but tiled windows are
+// resolved through the spatial index instead of walking every one of them
+static struct wlr_scene_node *scene_node_at(double lx, double ly,
+      double *sx, double *sy) {
+  struct wlr_scene_node *child;
+  wl_list_for_each_reverse(child, &server.scene->tree.children, link) {
+    if (child == &server.tile_tree->node && child->enabled && popup_count == 0) {
+      node_t *n = spatial_tiled_at(lx, ly);
+      struct wlr_scene_tree *tree = n ? client_get_scene_tree(n->client) : NULL;
+      if (tree) {
+        struct wlr_scene_node *hit = wlr_scene_node_at(&tree->node, lx, ly, sx, sy);
+        if (hit)
+          return hit;
+      }
+    }
+
+    // tab bars, gaps and anything the index missed
+    struct wlr_scene_node *hit = wlr_scene_node_at(child, lx, ly, sx, sy);
+    if (hit)
+      return hit;
+  }
+  return NULL;
 }
 
 static void *desktop_type_at(
       double lx, double ly, struct wlr_surface **surface,
       double *sx, double *sy) {
-  struct wlr_scene_node *node = wlr_scene_node_at(
-      &server.scene->tree.node, lx, ly, sx, sy);
+  struct wlr_scene_node *node = scene_node_at(lx, ly, sx, sy);
   if (node == NULL || node->type != WLR_SCENE_NODE_BUFFER)
       return NULL;
 
@@ -137,68 +172,6 @@ static uint32_t get_tiled_resizable_edges(node_t *node) {
   return edges;
 }
 
-static void update_scene_positions(node_t *n, struct wlr_box rect, desktop_t *d) {
-  if (!n || !d) return;
-
-  n->pending.rectangle = rect;
-  n->current.rectangle = rect;
-
-  if (is_leaf(n)) {
-    if (n->client) {
-      // apply window gap and border width to leaf nodes
-      struct wlr_box r = rect;
-      unsigned int bw = n->client->border_width;
-      int wg = (gapless_monocle && d->layout == LAYOUT_MONOCLE) ? 0 : d->window_gap;
-      int bleed = wg + 2 * bw;
-      r.x += bw;
-      r.y += bw;
-      r.width = (bleed < r.width ? r.width - bleed : 0);
-      r.height = (bleed < r.height ? r.height - bleed : 0);
-
-      n->client->tiled_rectangle = r;
-      n->client->committed_tiled_rectangle = r;
-
-      if (n->client->toplevel && n->client->toplevel->scene_tree) {
-        wlr_scene_node_set_position(&n->client->toplevel->scene_tree->node, r.x, r.y);
-        wlr_xdg_toplevel_set_size(n->client->toplevel->xdg_toplevel, r.width, r.height);
-
-        // update borders for toplevel
-        if (bw != 0) {
-          const struct wlr_box geo = {0, 0, r.width, r.height};
-          update_borders(n->client->toplevel->border_tree, n->client->toplevel->border_rects, geo, bw);
-          update_border_colors(n->client->toplevel->border_tree, n->client->toplevel->border_rects, n->client);
-          if (n->client->border_radius > 0.0f)
-            n->client->toplevel->border_dirty = true;
-        }
-      }
-      if (n->client->xwayland_view && n->client->xwayland_view->scene_tree) {
-        wlr_scene_node_set_position(&n->client->xwayland_view->scene_tree->node, r.x, r.y);
-        wlr_xwayland_surface_configure(n->client->xwayland_view->xwayland_surface,
-          r.x, r.y, r.width, r.height);
-
-        // update borders for xwayland
-        if (bw != 0) {
-          const struct wlr_box geo = {0, 0, r.width, r.height};
-          update_borders(n->client->xwayland_view->border_tree, n->client->xwayland_view->border_rects, geo, bw);
-          update_border_colors(n->client->xwayland_view->border_tree, n->client->xwayland_view->border_rects, n->client);
-        }
-      }
-    }
-  } else if (n->split_type == TYPE_VERTICAL) {
-    int split_x = rect.x + (int)(rect.width * n->split_ratio);
-    struct wlr_box left = {rect.x, rect.y, split_x - rect.x, rect.height};
-    struct wlr_box right = {split_x, rect.y, rect.x + rect.width - split_x, rect.height};
-    update_scene_positions(n->first_child, left, d);
-    update_scene_positions(n->second_child, right, d);
-  } else if (n->split_type == TYPE_HORIZONTAL) {
-    int split_y = rect.y + (int)(rect.height * n->split_ratio);
-    struct wlr_box top = {rect.x, rect.y, rect.width, split_y - rect.y};
-    struct wlr_box bottom = {rect.x, split_y, rect.width, rect.y + rect.height - split_y};
-    update_scene_positions(n->first_child, top, d);
-    update_scene_positions(n->second_child, bottom, d);
-  }
-}
-
 // process cursor motion for tiled window resizing
 static void process_cursor_tiled_resize(void) {
   node_t *node = server.tiled_resize_node;
@@ -254,17 +227,6 @@ static void process_cursor_tiled_resize(void) {
     parent->pending.split_ratio = new_ratio;
     parent->current.split_ratio = new_ratio;
   }
-
-  if (server.tiled_resize_parent_vertical && node->desktop) {
-    update_scene_positions(server.tiled_resize_parent_vertical,
-      server.tiled_resize_parent_vertical->rectangle,
-      node->desktop);
-  }
-  if (server.tiled_resize_parent_horizontal && node->desktop) {
-    update_scene_positions(server.tiled_resize_parent_horizontal,
-      server.tiled_resize_parent_horizontal->rectangle,
-      node->desktop);
-  }
 }
 
 static void process_cursor_move(void) {
@@ -395,6 +357,45 @@ static void process_cursor_resize(void) {
   }
 }
 
+// output whose frame applies the grab, tiled resizes follow the resized node
+static struct bwm_output *grab_output(void) {
+  node_t *node = server.tiled_resize_node;
+  if (node)
+    return node->destroying ? NULL : node->output;
+  return output_at(server.cursor->x, server.cursor->y);
+}
+
+static void flush_cursor_grab(void) {
+  if (!server.grab_pending)
+    return;
+  server.grab_pending = false;
+
+  if (server.cursor_mode == CURSOR_MOVE)
+    process_cursor_move();
+  else if (server.cursor_mode == CURSOR_RESIZE)
+    process_cursor_resize();
+
+  node_t *node = server.tiled_resize_node;
+  if (node) {
+    // one transaction per frame carries the new split ratios
+    if (!node->destroying && node->output && node->desktop)
+      arrange(node->output, node->desktop, true);
+  } else {
+    // floating geometry changes outside of transactions
+    spatial_invalidate();
+  }
+}
+
+void cursor_output_frame(struct bwm_output *output) {
+  if (!server.grab_pending)
+    return;
+  // a tiled resize waits for the frame of the output it lays out
+  struct bwm_output *m = grab_output();
+  if (m && m != output && server.tiled_resize_node)
+    return;
+  flush_cursor_grab();
+}
+
 static void process_cursor_motion(uint32_t time, double dx, double dy, double dx_unaccel, double dy_unaccel) {
 	if (time) {
 		wlr_relative_pointer_manager_v1_send_relative_motion(
@@ -429,11 +430,16 @@ static void process_cursor_motion(uint32_t time, double dx, double dy, double dx
 		}
 	}
 
-  if (server.cursor_mode == CURSOR_MOVE) {
-    process_cursor_move();
-    return;
-  } else if (server.cursor_mode == CURSOR_RESIZE) {
-    process_cursor_resize();
+  // grabs are sampled once per output frame
+  if (server.cursor_mode == CURSOR_MOVE || server.cursor_mode == CURSOR_RESIZE) {
+    if (!server.grab_pending) {
+      server.grab_pending = true;
+      struct bwm_output *m = grab_output();
+      if (m)
+        wlr_output_schedule_frame(m->wlr_output);
+      else
+        flush_cursor_grab();
+    }
     return;
   }
 
@@ -446,6 +452,21 @@ static void process_cursor_motion(uint32_t time, double dx, double dy, double dx
 
   double sx, sy;
   struct wlr_seat *seat = server.seat;
+
+  // still inside the same surface and nothing was restacked, skip the
+  // hit-test and focus handling
+  if (hover.surface != NULL && hover.surface == seat->pointer_state.focused_surface &&
+      hover.generation == spatial_generation() && !seat->drag) {
+    sx = server.cursor->x - hover.x;
+    sy = server.cursor->y - hover.y;
+    if (sx >= 0 && sy >= 0 &&
+        sx < hover.surface->current.width && sy < hover.surface->current.height &&
+        wlr_surface_point_accepts_input(hover.surface, sx, sy)) {
+      wlr_seat_pointer_notify_motion(seat, time, sx, sy);
+      return;
+    }
+  }
+
   struct wlr_surface *surface = NULL;
   void *type = desktop_type_at(server.cursor->x, server.cursor->y, &surface, &sx, &sy);
   if (type == NULL && !seat->drag)
@@ -455,6 +476,13 @@ static void process_cursor_motion(uint32_t time, double dx, double dy, double dx
   if (m && m != server.focused_output)
     server.focused_output = m;
 
+  node_t *last_node = hover.node;
+  uint32_t last_node_id = hover.node_id;
+  hover.surface = surface;
+  hover.node = NULL;
+  hover.x = server.cursor->x - sx;
+  hover.y = server.cursor->y - sy;
+
   if (surface) {
     wlr_seat_pointer_notify_enter(seat, surface, sx, sy);
     wlr_seat_pointer_notify_motion(seat, time, sx, sy);
@@ -477,15 +505,23 @@ static void process_cursor_motion(uint32_t time, double dx, double dy, double dx
         }
       }
 
-      if (node && node->output && node->desktop)
+      // moving between surfaces of the same window doesn't refocus it
+      hover.node = node;
+      hover.node_id = node ? node->id : 0;
+      bool same = node == last_node && node && node->id == last_node_id;
+      if (node && !same && node->output && node->desktop)
         focus_node(node->output, node->desktop, node);
     }
   } else {
     wlr_seat_pointer_clear_focus(seat);
   }
+
+  // taken last so restacking done by focus itself doesn't defeat the cache
+  hover.generation = spatial_generation();
 }
 
 void begin_interactive(struct bwm_toplevel *toplevel, enum cursor_mode mode, uint32_t edges) {
+  animation_finish(toplevel->node);
   server.grabbed_toplevel = toplevel;
   server.cursor_mode = mode;
 
@@ -493,6 +529,7 @@ void begin_interactive(struct bwm_toplevel *toplevel, enum cursor_mode mode, uin
   server.tiled_resize_node = NULL;
   server.tiled_resize_parent_vertical = NULL;
   server.tiled_resize_parent_horizontal = NULL;
+  server.grab_pending = false;
 
   if (mode == CURSOR_MOVE) {
     if (toplevel->node && toplevel->node->client) {
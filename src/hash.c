@@ -0,0 +1,181 @@
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define HASH_MIN_BUCKETS 16
+
+// fnv-1a
+uint32_t hash_string(const char *s) {
+  uint32_t h = 2166136261u;
+  for (; *s; s++) {
+    h ^= (uint8_t)*s;
+    h *= 16777619u;
+  }
+  return h;
+}
+
+static uint32_t hash_int(uint32_t x) {
+  x ^= x >> 16;
+  x *= 0x7feb352du;
+  x ^= x >> 15;
+  x *= 0x846ca68bu;
+  x ^= x >> 16;
+  return x;
+}
+
+static bool grow(struct bwm_hash *h) {
+  size_t count = h->bucket_count == 0 ? HASH_MIN_BUCKETS : h->bucket_count * 2;
+  struct bwm_hash_entry **buckets = calloc(count, sizeof(*buckets));
+  if (buckets == NULL)
+    return false;
+
+  // append to keep entries with equal keys in insertion order
+  for (size_t i = 0; i < h->bucket_count; i++) {
+    struct bwm_hash_entry *e = h->buckets[i];
+    while (e != NULL) {
+      struct bwm_hash_entry *next = e->next;
+      struct bwm_hash_entry **slot = &buckets[e->hash & (count - 1)];
+      while (*slot != NULL)
+        slot = &(*slot)->next;
+      e->next = NULL;
+      *slot = e;
+      e = next;
+    }
+  }
+
+  free(h->buckets);
+  h->buckets = buckets;
+  h->bucket_count = count;
+  return true;
+}
+
+static bool insert(struct bwm_hash *h, struct bwm_hash_entry *e) {
+  if (h->count >= h->bucket_count && !grow(h))
+    return false;
+
+  struct bwm_hash_entry **slot = &h->buckets[e->hash & (h->bucket_count - 1)];
+  while (*slot != NULL)
+    slot = &(*slot)->next;
+  e->next = NULL;
+  *slot = e;
+  h->count++;
+  return true;
+}
+
+bool hash_insert_name(struct bwm_hash *h, const char *name, void *value) {
+  struct bwm_hash_entry *e = calloc(1, sizeof(*e));
+  if (e == NULL)
+    return false;
+  e->name = strdup(name);
+  if (e->name == NULL) {
+    free(e);
+    return false;
+  }
+  e->hash = hash_string(name);
+  e->value = value;
+
+  if (!insert(h, e)) {
+    free(e->name);
+    free(e);
+    return false;
+  }
+  return true;
+}
+
+bool hash_insert_id(struct bwm_hash *h, uint32_t id, void *value) {
+  struct bwm_hash_entry *e = calloc(1, sizeof(*e));
+  if (e == NULL)
+    return false;
+  e->hash = hash_int(id);
+  e->id = id;
+  e->value = value;
+
+  if (!insert(h, e)) {
+    free(e);
+    return false;
+  }
+  return true;
+}
+
+struct bwm_hash_entry *hash_next_name(struct bwm_hash *h, const char *name,
+                                      struct bwm_hash_entry *prev) {
+  if (h->bucket_count == 0)
+    return NULL;
+
+  uint32_t hash = prev ? prev->hash : hash_string(name);
+  struct bwm_hash_entry *e = prev ? prev->next : h->buckets[hash & (h->bucket_count - 1)];
+  for (; e != NULL; e = e->next)
+    if (e->name != NULL && e->hash == hash && strcmp(e->name, name) == 0)
+      return e;
+  return NULL;
+}
+
+void *hash_lookup_name(struct bwm_hash *h, const char *name) {
+  struct bwm_hash_entry *e = hash_next_name(h, name, NULL);
+  return e ? e->value : NULL;
+}
+
+void *hash_lookup_id(struct bwm_hash *h, uint32_t id) {
+  if (h->bucket_count == 0)
+    return NULL;
+
+  uint32_t hash = hash_int(id);
+  for (struct bwm_hash_entry *e = h->buckets[hash & (h->bucket_count - 1)]; e != NULL; e = e->next)
+    if (e->name == NULL && e->id == id)
+      return e->value;
+  return NULL;
+}
+
+static void unlink_entry(struct bwm_hash *h, struct bwm_hash_entry **slot) {
+  struct bwm_hash_entry *e = *slot;
+  *slot = e->next;
+  free(e->name);
+  free(e);
+  h->count--;
+}
+
+void hash_remove_name(struct bwm_hash *h, const char *name, void *value) {
+  if (h->bucket_count == 0)
+    return;
+
+  uint32_t hash = hash_string(name);
+  struct bwm_hash_entry **slot = &h->buckets[hash & (h->bucket_count - 1)];
+  for (; *slot != NULL; slot = &(*slot)->next) {
+    struct bwm_hash_entry *e = *slot;
+    if (e->value == value && e->name != NULL && strcmp(e->name, name) == 0) {
+      unlink_entry(h, slot);
+      return;
+    }
+  }
+}
+
+void hash_remove_id(struct bwm_hash *h, uint32_t id, void *value) {
+  if (h->bucket_count == 0)
+    return;
+
+  uint32_t hash = hash_int(id);
+  struct bwm_hash_entry **slot = &h->buckets[hash & (h->bucket_count - 1)];
+  for (; *slot != NULL; slot = &(*slot)->next) {
+    struct bwm_hash_entry *e = *slot;
+    if (e->value == value && e->name == NULL && e->id == id) {
+      unlink_entry(h, slot);
+      return;
+    }
+  }
+}
+
+void hash_fini(struct bwm_hash *h) {
+  for (size_t i = 0; i < h->bucket_count; i++) {
+    struct bwm_hash_entry *e = h->buckets[i];
+    while (e != NULL) {
+      struct bwm_hash_entry *next = e->next;
+      free(e->name);
+      free(e);
+      e = next;
+    }
+  }
+  free(h->buckets);
+  h->buckets = NULL;
+  h->bucket_count = 0;
+  h->count = 0;
+}
@@ -15,6 +15,7 @@
 #include "config.h"
 #include "scroller.h"
 #include "text.h"
+#include "animation.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -474,8 +475,7 @@ static void ipc_cmd_output(char **args, int num, int client_fd) {
     }
     args++;
     num--;
-    strncpy(mon->name, *args, SMALEN - 1);
-    mon->name[SMALEN - 1] = '\0';
+    output_rename(mon, *args);
     transaction_commit_dirty();
     send_success(client_fd, "renamed\n");
   } else if (streq("add-desktops", subcmd) || streq("-a", subcmd) || streq("--add-desktops", subcmd)) {
@@ -486,30 +486,11 @@ static void ipc_cmd_output(char **args, int num, int client_fd) {
     args++;
     num--;
     while (num > 0) {
-      desktop_t *d = (desktop_t *)calloc(1, sizeof(desktop_t));
-      d->id = next_desktop_id++;
-      strncpy(d->name, *args, SMALEN - 1);
-      d->name[SMALEN - 1] = '\0';
-      d->layout = LAYOUT_TILED;
-      d->user_layout = LAYOUT_TILED;
-      d->window_gap = window_gap;
-      d->border_width = border_width;
-      d->padding = (padding_t){0};
-      d->root = NULL;
-      d->focus = NULL;
-
-      if (mon->desk_tail) {
-        d->prev = mon->desk_tail;
-        mon->desk_tail->next = d;
-        mon->desk_tail = d;
-      } else {
-        mon->desk = d;
-        mon->desk_head = d;
-        mon->desk_tail = d;
+      desktop_t *d = make_desktop(*args);
+      if (d) {
+        output_append_desktop(mon, d);
+        workspace_desktop_add(d);
       }
-      d->output = mon;
-
-      workspace_create_desktop(d->name);
 
       args++;
       num--;
@@ -528,40 +509,31 @@ static void ipc_cmd_output(char **args, int num, int client_fd) {
       args++;
       num--;
 
+      // desktops past the new list are freed, refuse while they hold windows
       desktop_t *d = mon->desk;
+      for (int i = 0; i < num && d != NULL; i++)
+        d = d->next;
+      for (; d != NULL; d = d->next) {
+        if (desktop_has_windows(d)) {
+          send_failure(client_fd, "output desktops: desktop to remove still has windows\n");
+          return;
+        }
+      }
+
+      d = mon->desk;
       for (; num > 0 && d != NULL; d = d->next) {
-        strncpy(d->name, *args, SMALEN - 1);
-        d->name[SMALEN - 1] = '\0';
-        workspace_create_desktop(d->name);
+        desktop_rename(d, *args);
+        workspace_desktop_update(d);
         args++;
         num--;
       }
 
       while (num > 0) {
-        desktop_t *newd = (desktop_t *)calloc(1, sizeof(desktop_t));
-        newd->id = next_desktop_id++;
-        strncpy(newd->name, *args, SMALEN - 1);
-        newd->name[SMALEN - 1] = '\0';
-        newd->layout = LAYOUT_TILED;
-        newd->user_layout = LAYOUT_TILED;
-        newd->window_gap = window_gap;
-        newd->border_width = border_width;
-        newd->padding = (padding_t){0};
-        newd->root = NULL;
-        newd->focus = NULL;
-
-        if (mon->desk_tail) {
-          newd->prev = mon->desk_tail;
-          mon->desk_tail->next = newd;
-          mon->desk_tail = newd;
-        } else {
-          mon->desk = newd;
-          mon->desk_head = newd;
-          mon->desk_tail = newd;
+        desktop_t *newd = make_desktop(*args);
+        if (newd) {
+          output_append_desktop(mon, newd);
+          workspace_desktop_add(newd);
         }
-        newd->output = mon;
-
-        workspace_create_desktop(newd->name);
         args++;
         num--;
       }
@@ -586,9 +558,11 @@ static void ipc_cmd_output(char **args, int num, int client_fd) {
             mon->desk_tail = d->prev;
         }
         desktop_t *next = d->next;
+        workspace_desktop_remove(d);
+        free_desktop(d);
         d = next;
-        free(d);
       }
+      output_sync_desktops(mon);
 
       transaction_commit_dirty();
       workspace_sync();
@@ -652,6 +626,11 @@ static void ipc_cmd_output(char **args, int num, int client_fd) {
     else if (server.focused_output == m1)
       server.focused_output = m0;
 
+    desktops_mark_dirty(m0);
+    desktops_mark_dirty(m1);
+    output_sync_desktops(m0);
+    output_sync_desktops(m1);
+    workspace_sync();
     transaction_commit_dirty();
     send_success(client_fd, "swapped\n");
   } else if (streq("remove", subcmd) || streq("-r", subcmd) || streq("--remove", subcmd)) {
@@ -842,13 +821,7 @@ static void ipc_cmd_input(char **args, int num, int client_fd) {
 }
 
 desktop_t *find_desktop_by_name_in_monitor(struct bwm_output *mon, const char *name) {
-  desktop_t *d = mon->desk;
-  while (d) {
-    if (strcmp(d->name, name) == 0)
-      return d;
-    d = d->next;
-  }
-  return NULL;
+  return desktop_from_name(mon, name);
 }
 
 static void ipc_cmd_node(char **args, int num, int client_fd) {
@@ -959,6 +932,7 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
     n->ntxnrefs = 0;
 
     insert_node(target, n, find_public(target));
+    n->client->shown = true;
 
     target->focus = n;
     if (target == m->desk && target->focus == n) {
@@ -985,14 +959,6 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
       }
       arrange(m, target, true);
     } else {
-      for (node_t *n_iter = first_extrema(target->root); n_iter != NULL; n_iter = next_leaf(n_iter, target->root)) {
-        if (n_iter->client) {
-          n_iter->client->shown = false;
-          struct wlr_scene_tree *scene_tree = client_get_scene_tree(n_iter->client);
-          if (scene_tree)
-            wlr_scene_node_set_enabled(&scene_tree->node, false);
-        }
-      }
       arrange(m, target, false);
     }
 
@@ -1011,15 +977,6 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
         }
       }
       arrange(m, src_desk, true);
-    } else if (src_desk->root) {
-      for (node_t *n_iter = first_extrema(src_desk->root); n_iter != NULL; n_iter = next_leaf(n_iter, src_desk->root)) {
-        if (n_iter->client) {
-          n_iter->client->shown = false;
-          struct wlr_scene_tree *scene_tree = client_get_scene_tree(n_iter->client);
-          if (scene_tree)
-            wlr_scene_node_set_enabled(&scene_tree->node, false);
-        }
-      }
     }
 
     send_success(client_fd, "node sent to desktop\n");
@@ -1400,12 +1357,9 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
     node_t *n2 = NULL;
     int target_id = atoi(*args);
     if (target_id > 0) {
-      for (node_t *n = first_extrema(m->desk->root); n != NULL; n = next_leaf(n, m->desk->root)) {
-        if (n->id == (uint32_t)target_id) {
-          n2 = n;
-          break;
-        }
-      }
+      node_t *n = node_from_id((uint32_t)target_id);
+      if (n != NULL && n->desktop == m->desk && is_leaf(n))
+        n2 = n;
     }
 
     if (!n2) {
@@ -1452,6 +1406,7 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
       n1->parent = n2;
       n2->first_child = n1;
     }
+    update_clients_count(n1);
 
     target_desk->focus = n1;
     if (target_desk == m->desk)
@@ -1743,6 +1698,7 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
     } else {
       m->desk->root = receptacle;
     }
+    update_clients_count(receptacle);
 
     transaction_commit_dirty();
     send_success(client_fd, "receptacle inserted\n");
@@ -1846,12 +1802,9 @@ static void ipc_cmd_node(char **args, int num, int client_fd) {
     node_t *n2 = NULL;
     int target_id = atoi(*args);
     if (target_id > 0) {
-      for (node_t *n = first_extrema(m->desk->root); n != NULL; n = next_leaf(n, m->desk->root)) {
-        if (n->id == (uint32_t)target_id) {
-          n2 = n;
-          break;
-        }
-      }
+      node_t *n = node_from_id((uint32_t)target_id);
+      if (n != NULL && n->desktop == m->desk && is_leaf(n))
+        n2 = n;
     }
 
     if (!n2) {
@@ -1954,8 +1907,8 @@ static void ipc_cmd_desktop(char **args, int num, int client_fd) {
       return;
     }
     args++;
-    strncpy(desk->name, *args, SMALEN - 1);
-    desk->name[SMALEN - 1] = '\0';
+    desktop_rename(desk, *args);
+    workspace_desktop_update(desk);
     transaction_commit_dirty();
     send_success(client_fd, "renamed\n");
   } else if (streq("-s", *args) || streq("--swap", *args)) {
@@ -2031,6 +1984,11 @@ static void ipc_cmd_desktop(char **args, int num, int client_fd) {
     if (mon->desk == d0) mon->desk = d1;
     else if (mon->desk == d1) mon->desk = d0;
 
+    desktops_mark_dirty(m0);
+    desktops_mark_dirty(m1);
+    output_sync_desktops(m0);
+    output_sync_desktops(m1);
+    workspace_sync();
     transaction_commit_dirty();
     send_success(client_fd, "swapped\n");
   } else if (streq("-r", *args) || streq("--remove", *args)) {
@@ -2038,6 +1996,10 @@ static void ipc_cmd_desktop(char **args, int num, int client_fd) {
       send_failure(client_fd, "desktop -r: cannot remove the only desktop\n");
       return;
     }
+    if (desktop_has_windows(desk)) {
+      send_failure(client_fd, "desktop -r: desktop still has windows\n");
+      return;
+    }
 
     desktop_t *prev = desk->prev;
     desktop_t *next = desk->next;
@@ -2056,7 +2018,10 @@ static void ipc_cmd_desktop(char **args, int num, int client_fd) {
         focus_node(mon, mon->desk, mon->desk->focus);
     }
 
-    free(desk);
+    workspace_desktop_remove(desk);
+    free_desktop(desk);
+    output_sync_desktops(mon);
+    workspace_sync();
     transaction_commit_dirty();
     send_success(client_fd, "removed\n");
   } else if (streq("-b", *args) || streq("--bubble", *args)) {
@@ -2161,6 +2126,10 @@ static void ipc_cmd_desktop(char **args, int num, int client_fd) {
         focus_node(src_mon, src_mon->desk, src_mon->desk->focus);
     }
 
+    desk->layout_dirty = true;
+    output_sync_desktops(src_mon);
+    output_sync_desktops(target);
+    workspace_sync();
     transaction_commit_dirty();
     send_success(client_fd, "desktop moved to monitor\n");
   } else {
@@ -2168,13 +2137,6 @@ static void ipc_cmd_desktop(char **args, int num, int client_fd) {
   }
 }
 
-struct bwm_output *find_output_by_name(const char *name) {
-  for (struct bwm_output *m = mon_head; m != NULL; m = m->next)
-    if (strcmp(m->name, name) == 0)
-      return m;
-  return NULL;
-}
-
 static void ipc_cmd_query(char **args, int num, int client_fd) {
   char buf[BWM_BUFSIZ];
   size_t offset = 0;
@@ -2229,13 +2191,9 @@ static void ipc_cmd_query(char **args, int num, int client_fd) {
         send_failure(client_fd, "query -n: invalid node id\n");
         return;
       }
-      struct bwm_toplevel *toplevel;
-      wl_list_for_each(toplevel, &server.toplevels, link) {
-        if (toplevel->node && toplevel->node->id == (uint32_t)node_id) {
-          filter_node = toplevel->node;
-          break;
-        }
-      }
+      filter_node = node_from_id((uint32_t)node_id);
+      if (filter_node && filter_node->client == NULL)
+        filter_node = NULL;
       if (!filter_node) {
         send_failure(client_fd, "query -n: node not found\n");
         return;
@@ -2403,6 +2361,9 @@ static void ipc_cmd_query(char **args, int num, int client_fd) {
         foreign_id);
     }
     send_success(client_fd, buf);
+  } else if (streq("--transactions", *args)) {
+    transaction_stats_format(buf, sizeof(buf));
+    send_success(client_fd, buf);
   } else {
     send_failure(client_fd, "query: unknown command\n");
   }
@@ -2534,12 +2495,23 @@ static void ipc_cmd_wm(char **args, int num, int client_fd) {
   }
 }
 
+// re-parse border colors and repaint the visible desktops
+static void border_colors_changed(void) {
+  parse_border_colors();
+  for (struct bwm_output *m = mon_head; m != NULL; m = m->next)
+    desktop_update_border_colors(m->desk);
+}
+
 static void ipc_cmd_config(char **args, int num, int client_fd) {
   if (num < 1) {
     send_failure(client_fd, "config: Missing arguments\n");
     return;
   }
 
+  // any setting may feed into the layout, let hidden desktops catch up
+  if (num >= 2)
+    desktops_mark_dirty(NULL);
+
   if (streq("border_width", *args)) {
     if (num >= 2) {
       int val = atoi(args[1]);
@@ -2877,6 +2849,36 @@ static void ipc_cmd_config(char **args, int num, int client_fd) {
       snprintf(buf, sizeof(buf), "%d\n", scroller_structs);
       send_success(client_fd, buf);
     }
+  } else if (streq("scroller_animation_duration", *args)) {
+    if (num >= 2) {
+      scroller_animation_duration = atoi(args[1]);
+      if (scroller_animation_duration < 0) scroller_animation_duration = 0;
+      send_success(client_fd, "scroller_animation_duration set\n");
+    } else {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%d\n", scroller_animation_duration);
+      send_success(client_fd, buf);
+    }
+  } else if (streq("animation_duration", *args)) {
+    if (num >= 2) {
+      animation_duration = atoi(args[1]);
+      if (animation_duration < 0) animation_duration = 0;
+      send_success(client_fd, "animation_duration set\n");
+    } else {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%d\n", animation_duration);
+      send_success(client_fd, buf);
+    }
+  } else if (streq("animation_frame_budget", *args)) {
+    if (num >= 2) {
+      animation_frame_budget = atoi(args[1]);
+      if (animation_frame_budget < 0) animation_frame_budget = 0;
+      send_success(client_fd, "animation_frame_budget set\n");
+    } else {
+      char buf[64];
+      snprintf(buf, sizeof(buf), "%d\n", animation_frame_budget);
+      send_success(client_fd, buf);
+    }
   } else if (streq("focus_follows_pointer", *args)) {
     if (num >= 2) {
       focus_follows_pointer = (strcmp(args[1], "true") == 0);
@@ -2893,6 +2895,13 @@ static void ipc_cmd_config(char **args, int num, int client_fd) {
     } else {
       send_success(client_fd, pointer_follows_focus ? "true\n" : "false\n");
     }
+  } else if (streq("transaction_partial_apply", *args)) {
+    if (num >= 2) {
+      transaction_partial_apply = (strcmp(args[1], "true") == 0);
+      send_success(client_fd, "transaction_partial_apply set\n");
+    } else {
+      send_success(client_fd, transaction_partial_apply ? "true\n" : "false\n");
+    }
   } else if (streq("split_ratio", *args)) {
     if (num >= 2) {
       double val = atof(args[1]);
@@ -2952,6 +2961,7 @@ static void ipc_cmd_config(char **args, int num, int client_fd) {
     if (num >= 2) {
       strncpy(normal_border_color, args[1], sizeof(normal_border_color) - 1);
       normal_border_color[sizeof(normal_border_color) - 1] = '\0';
+      border_colors_changed();
       transaction_commit_dirty();
       send_success(client_fd, "normal_border_color set\n");
     } else {
@@ -2962,6 +2972,7 @@ static void ipc_cmd_config(char **args, int num, int client_fd) {
     if (num >= 2) {
       strncpy(active_border_color, args[1], sizeof(active_border_color) - 1);
       active_border_color[sizeof(active_border_color) - 1] = '\0';
+      border_colors_changed();
       transaction_commit_dirty();
       send_success(client_fd, "active_border_color set\n");
     } else {
@@ -2972,6 +2983,7 @@ static void ipc_cmd_config(char **args, int num, int client_fd) {
     if (num >= 2) {
       strncpy(focused_border_color, args[1], sizeof(focused_border_color) - 1);
       focused_border_color[sizeof(focused_border_color) - 1] = '\0';
+      border_colors_changed();
       transaction_commit_dirty();
       send_success(client_fd, "focused_border_color set\n");
     } else {
@@ -2982,6 +2994,7 @@ static void ipc_cmd_config(char **args, int num, int client_fd) {
     if (num >= 2) {
       strncpy(presel_feedback_color, args[1], sizeof(presel_feedback_color) - 1);
       presel_feedback_color[sizeof(presel_feedback_color) - 1] = '\0';
+      border_colors_changed();
       transaction_commit_dirty();
       send_success(client_fd, "presel_feedback_color set\n");
     } else {
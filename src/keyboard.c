@@ -11,6 +11,7 @@
 #include "scroller.h"
 #include "input_method.h"
 #include "xwayland.h"
+#include "spatial.h"
 #include <stdlib.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
@@ -250,6 +251,32 @@ bool handle_keybind(uint32_t modifiers, xkb_keysym_t sym) {
   return false;
 }
 
+// geometric fallback when the tree has no neighbor in dir, which also
+// reaches floating windows and other outputs
+static bool focus_direction_spatial(direction_t dir) {
+  struct bwm_output *target = NULL;
+  node_t *n = spatial_nearest(mon->desk->focus, dir, false, &target);
+  if (n == NULL || target == NULL || target->desk == NULL)
+    return false;
+
+  focus_node(target, target->desk, n);
+  return true;
+}
+
+static bool swap_direction_spatial(direction_t dir) {
+  node_t *f = mon->desk->focus;
+  if (f->client == NULL || !IS_TILED(f->client))
+    return false;
+
+  struct bwm_output *target = NULL;
+  node_t *n = spatial_nearest(f, dir, true, &target);
+  if (n == NULL || target == NULL || target->desk == NULL)
+    return false;
+
+  swap_nodes(mon, mon->desk, f, target, target->desk, n);
+  return true;
+}
+
 // navigation actions
 void focus_west(void) {
   if (mon == NULL || mon->desk == NULL || mon->desk->focus == NULL)
@@ -270,6 +297,8 @@ void focus_west(void) {
       focus_node(mon, mon->desk, n);
       wlr_log(WLR_DEBUG, "Focused west");
     }
+  } else if (focus_direction_spatial(DIR_WEST)) {
+    wlr_log(WLR_DEBUG, "Focused west (spatial)");
   }
 }
 
@@ -292,6 +321,8 @@ void focus_east(void) {
       focus_node(mon, mon->desk, n);
       wlr_log(WLR_DEBUG, "Focused east");
     }
+  } else if (focus_direction_spatial(DIR_EAST)) {
+    wlr_log(WLR_DEBUG, "Focused east (spatial)");
   }
 }
 
@@ -314,6 +345,8 @@ void focus_south(void) {
       focus_node(mon, mon->desk, n);
       wlr_log(WLR_DEBUG, "Focused south");
     }
+  } else if (focus_direction_spatial(DIR_SOUTH)) {
+    wlr_log(WLR_DEBUG, "Focused south (spatial)");
   }
 }
 
@@ -336,6 +369,8 @@ void focus_north(void) {
       focus_node(mon, mon->desk, n);
       wlr_log(WLR_DEBUG, "Focused north");
     }
+  } else if (focus_direction_spatial(DIR_NORTH)) {
+    wlr_log(WLR_DEBUG, "Focused north (spatial)");
   }
 }
 
@@ -351,6 +386,8 @@ void swap_west(void) {
       swap_nodes(mon, mon->desk, mon->desk->focus, mon, mon->desk, n);
       wlr_log(WLR_INFO, "Swapped with west window");
     }
+  } else if (swap_direction_spatial(DIR_WEST)) {
+    wlr_log(WLR_INFO, "Swapped with west window (spatial)");
   }
 }
 
@@ -365,6 +402,8 @@ void swap_east(void) {
       swap_nodes(mon, mon->desk, mon->desk->focus, mon, mon->desk, n);
       wlr_log(WLR_INFO, "Swapped with east window");
     }
+  } else if (swap_direction_spatial(DIR_EAST)) {
+    wlr_log(WLR_INFO, "Swapped with east window (spatial)");
   }
 }
 
@@ -379,6 +418,8 @@ void swap_north(void) {
       swap_nodes(mon, mon->desk, mon->desk->focus, mon, mon->desk, n);
       wlr_log(WLR_INFO, "Swapped with north window");
     }
+  } else if (swap_direction_spatial(DIR_NORTH)) {
+    wlr_log(WLR_INFO, "Swapped with north window (spatial)");
   }
 }
 
@@ -393,6 +434,8 @@ void swap_south(void) {
       swap_nodes(mon, mon->desk, mon->desk->focus, mon, mon->desk, n);
       wlr_log(WLR_INFO, "Swapped with south window");
     }
+  } else if (swap_direction_spatial(DIR_SOUTH)) {
+    wlr_log(WLR_INFO, "Swapped with south window (spatial)");
   }
 }
 
@@ -431,7 +474,7 @@ void toggle_floating(void) {
        n->id, n->parent->id);
 
     n->hidden = false;
-    wlr_scene_node_reparent(&scene_tree->node, server.tile_tree);
+    wlr_scene_node_reparent(&scene_tree->node, desktop_layer(n->desktop, server.tile_tree));
 
     n->client->last_state = n->client->state;
     n->client->state = STATE_TILED;
@@ -462,7 +505,7 @@ void toggle_floating(void) {
       wlr_scene_node_set_position(&n->client->xwayland_view->scene_tree->node,
         n->client->floating_rectangle.x, n->client->floating_rectangle.y);
 
-    wlr_scene_node_reparent(&scene_tree->node, server.float_tree);
+    wlr_scene_node_reparent(&scene_tree->node, desktop_layer(n->desktop, server.float_tree));
 
     // restore focus
     mon->desk->focus = n;
@@ -502,9 +545,9 @@ void toggle_fullscreen(void) {
       restore = STATE_TILED;
 
     if (restore == STATE_FLOATING)
-      wlr_scene_node_reparent(&scene_tree->node, server.float_tree);
+      wlr_scene_node_reparent(&scene_tree->node, desktop_layer(n->desktop, server.float_tree));
     else
-      wlr_scene_node_reparent(&scene_tree->node, server.tile_tree);
+      wlr_scene_node_reparent(&scene_tree->node, desktop_layer(n->desktop, server.tile_tree));
 
     if (n->client->toplevel && n->client->toplevel->xdg_toplevel)
       wlr_xdg_toplevel_set_fullscreen(n->client->toplevel->xdg_toplevel, false);
@@ -514,7 +557,7 @@ void toggle_fullscreen(void) {
     set_state(mon, mon->desk, n, restore);
     wlr_log(WLR_INFO, "Fullscreen disabled");
   } else {
-    wlr_scene_node_reparent(&scene_tree->node, server.full_tree);
+    wlr_scene_node_reparent(&scene_tree->node, desktop_layer(n->desktop, server.full_tree));
 
     if (n->client->toplevel && n->client->toplevel->xdg_toplevel)
       wlr_xdg_toplevel_set_fullscreen(n->client->toplevel->xdg_toplevel, true);
@@ -642,6 +685,7 @@ void send_to_desktop(int desktop_index) {
   }
 
   insert_node(target, n, find_public(target));
+  n->client->shown = true;
   target->focus = n;
 
   arrange(mon, src_desk, true);
@@ -704,6 +748,7 @@ void send_to_desktop_by_name(const char *name) {
 
   // add to target desktop
   insert_node(target, n, find_public(target));
+  n->client->shown = true;
   target->focus = n;
 
   // Ensure the moved node respects initial_polarity
@@ -5,6 +5,7 @@
 #include "tree.h"
 #include "input_method.h"
 #include "blur.h"
+#include "spatial.h"
 #include <stdlib.h>
 #include <wayland-server-core.h>
 #include <wlr/util/log.h>
@@ -208,6 +209,8 @@ void arrange_layers(struct bwm_output *output) {
   struct bwm_layer_surface *layer;
   int i;
 
+  spatial_invalidate();
+
   if (!output->wlr_output->enabled)
     return;
 
@@ -224,6 +227,8 @@ void arrange_layers(struct bwm_output *output) {
   if (!wlr_box_equal(&usable_area, &output->usable_area)) {
     output->usable_area = usable_area;
     struct bwm_output *m = output;
+    // hidden desktops catch up when they are next shown
+    desktops_mark_dirty(m);
     if (m && m->desk)
       arrange(m, m->desk, true);
   }
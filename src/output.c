@@ -7,7 +7,12 @@
 #include "toplevel.h"
 #include "tree.h"
 #include "blur.h"
+#include "cursor.h"
 #include "types.h"
+#include "workspace.h"
+#include "hash.h"
+#include "scroller.h"
+#include "animation.h"
 #include <time.h>
 #include <stdlib.h>
 #include <string.h>
@@ -22,6 +27,8 @@
 
 static void handle_output_destroy(struct wl_listener *listener, void *data);
 
+static struct bwm_hash output_names;
+
 static enum wlr_scale_filter_mode get_scale_filter(struct bwm_output *output,
 		struct wlr_scene_buffer *buffer) {
 	if (buffer->dst_width > 0 && buffer->dst_height > 0 && (
@@ -93,6 +100,11 @@ void output_frame(struct wl_listener *listener, void *data) {
 	if (!scene_output)
 		return;
 
+	cursor_output_frame(output);
+	toplevel_flush_names();
+	scroller_animate(output);
+	animation_tick(output);
+
 	output_configure_scene(output);
 
 	if (blur_ctx.available)
@@ -164,6 +176,14 @@ static void handle_output_destroy(struct wl_listener *listener, void *data) {
   wl_list_remove(&output->request_state.link);
   wl_list_remove(&output->destroy.link);
 
+  animation_output_destroyed(output);
+  hash_remove_name(&output_names, output->name, output);
+
+  // nothing may keep pointing at this output once it is freed, bars could
+  // still activate or assign through the handles otherwise
+  workspace_output_evacuate(output);
+  workspace_output_remove(output);
+
   if (output->prev)
     output->prev->next = output->next;
   else
@@ -199,6 +219,7 @@ void handle_new_output(struct wl_listener *listener, void *data) {
   output->allow_tearing = false;
   strncpy(output->name, wlr_output->name, SMALEN - 1);
   output->name[SMALEN - 1] = 0;
+  hash_insert_name(&output_names, output->name, output);
   output->id = next_monitor_id++;
   output->wired = true;
   output->window_gap = window_gap;
@@ -206,23 +227,12 @@ void handle_new_output(struct wl_listener *listener, void *data) {
   output->padding = (padding_t){0};
   output->rectangle = (struct wlr_box){0, 0, 1920, 1080};
 
-  // create default workspace for output
-  desktop_t *d = calloc(1, sizeof(desktop_t));
-  if (d) {
-    d->id = next_desktop_id++;
-    strncpy(d->name, "default", SMALEN - 1);
-    d->layout = LAYOUT_TILED;
-    d->user_layout = LAYOUT_TILED;
-    d->window_gap = window_gap;
-    d->border_width = border_width;
-    d->padding = (padding_t){0};
-    d->root = NULL;
-    d->focus = NULL;
-    d->output = output;
-
-    output->desk = d;
-    output->desk_head = d;
-    output->desk_tail = d;
+  // create default workspace for output, unless it takes over the desktops
+  // left behind by the last unplugged one
+  if (!workspace_adopt_parked(output)) {
+    desktop_t *d = make_desktop("default");
+    if (d)
+      output_append_desktop(output, d);
   }
 
   // add to monitor linked list
@@ -307,11 +317,7 @@ void output_enable(struct bwm_output *output) {
 
   output_update_usable_area(output);
 
-  if (server.workspace_manager && !wl_list_empty(&server.workspace_manager->groups)) {
-    struct wlr_ext_workspace_group_handle_v1 *group;
-    group = wl_container_of(server.workspace_manager->groups.next, group, link);
-    wlr_ext_workspace_group_handle_v1_output_enter(group, output->wlr_output);
-  }
+  workspace_output_add(output);
 }
 
 void output_disable(struct bwm_output *output) {
@@ -329,6 +335,9 @@ void output_destroy(struct bwm_output *output) {
   if (!output)
     return;
 
+  workspace_output_remove(output);
+  hash_remove_name(&output_names, output->name, output);
+
   if (output->layer_bg)
     wlr_scene_node_destroy(&output->layer_bg->node);
   if (output->layer_bottom)
@@ -341,6 +350,21 @@ void output_destroy(struct bwm_output *output) {
   free(output);
 }
 
+void output_rename(struct bwm_output *output, const char *name) {
+  hash_remove_name(&output_names, output->name, output);
+  strncpy(output->name, name, SMALEN - 1);
+  output->name[SMALEN - 1] = '\0';
+  hash_insert_name(&output_names, output->name, output);
+}
+
+struct bwm_output *find_output_by_name(const char *name) {
+  return hash_lookup_name(&output_names, name);
+}
+
+void output_fini(void) {
+  hash_fini(&output_names);
+}
+
 struct bwm_output *output_from_wlr_output(struct wlr_output *wlr_output) {
   if (!wlr_output)
     return NULL;
@@ -440,13 +464,48 @@ void output_update_scale(struct bwm_output *output, float scale) {
 
   blur_invalidate_mica(output->blur_ctx);
 
-  // rearrange all desktop on this output
-  for (desktop_t *d = output->desk; d != NULL; d = d->next)
-    arrange(output, d, true);
+  // rearrange the shown desktop, the others wait until they are switched to
+  desktops_mark_dirty(output);
+  if (output->desk)
+    arrange(output, output->desk, true);
 
   update_idle_inhibitors(NULL);
 }
 
+void output_append_desktop(struct bwm_output *output, desktop_t *d) {
+  d->output = output;
+  d->prev = output->desk_tail;
+  d->next = NULL;
+
+  if (output->desk_tail)
+    output->desk_tail->next = d;
+  else
+    output->desk_head = d;
+  output->desk_tail = d;
+
+  if (output->desk == NULL)
+    output->desk = d;
+}
+
+// take d out of the output's list, the output shows a neighbour if it was
+// showing d
+void output_unlink_desktop(struct bwm_output *output, desktop_t *d) {
+  if (d->prev)
+    d->prev->next = d->next;
+  if (d->next)
+    d->next->prev = d->prev;
+  if (output->desk_head == d)
+    output->desk_head = d->next;
+  if (output->desk_tail == d)
+    output->desk_tail = d->prev;
+  if (output->desk == d)
+    output->desk = d->next ? d->next : d->prev;
+
+  d->prev = NULL;
+  d->next = NULL;
+  d->output = NULL;
+}
+
 struct bwm_output *output_get_valid(void) {
   for (struct bwm_output *m = mon_head; m != NULL; m = m->next)
     if (m->enabled && m->wlr_output)
@@ -218,8 +218,7 @@ void output_config_apply(struct output_config *oc) {
     output->allow_tearing = oc->allow_tearing;
 
   if (output && wlr_output->enabled) {
-    strncpy(output->name, wlr_output->name, SMALEN - 1);
-    output->name[SMALEN - 1] = '\0';
+    output_rename(output, wlr_output->name);
     output_enable(output);
   }
 }
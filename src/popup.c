@@ -9,6 +9,9 @@
 #include "layer.h"
 #include "output.h"
 #include "toplevel.h"
+#include "spatial.h"
+
+int popup_count = 0;
 
 static void create_xdg_popup(struct wlr_xdg_popup *xdg_popup,
 	struct wlr_scene_tree *parent_tree, struct wlr_scene_tree *image_capture_parent_tree);
@@ -66,6 +69,8 @@ void popup_destroy(struct wl_listener *listener, void *data) {
   wl_list_remove(&popup->new_popup.link);
   wl_list_remove(&popup->destroy.link);
 
+  popup_count--;
+  spatial_invalidate();
   free(popup);
 }
 
@@ -92,6 +97,9 @@ static void create_xdg_popup(struct wlr_xdg_popup *xdg_popup,
 
   popup->destroy.notify = popup_destroy;
   wl_signal_add(&xdg_popup->events.destroy, &popup->destroy);
+
+  popup_count++;
+  spatial_invalidate();
 }
 
 void handle_new_xdg_popup(struct wl_listener *listener, void *data) {
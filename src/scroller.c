@@ -2,9 +2,12 @@
 #include "tree.h"
 #include "toplevel.h"
 #include "output.h"
+#include "spatial.h"
 #include <stdlib.h>
 #include <math.h>
+#include <time.h>
 #include <wlr/util/log.h>
+#include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_xdg_shell.h>
 
 // Configuration defaults
@@ -16,6 +19,7 @@ bool scroller_prefer_center = true;
 bool scroller_prefer_overspread = false;
 bool scroller_ignore_proportion_single = false;
 bool edge_scroller_pointer_focus = true;
+int scroller_animation_duration = 0;
 
 // Proportion presets
 float *scroller_proportion_preset = NULL;
@@ -47,32 +51,199 @@ client_t *scroller_get_stack_head(client_t *c) {
   return c;
 }
 
-int scroller_collect_nodes(desktop_t *d, node_t ***out_nodes) {
-  if (!d || !d->root) return 0;
+// refresh d->columns with one leaf walk, the array only grows. Leaf order
+// changes from many places (rotate, flip, swaps) so it is refreshed on use
+static int scroller_collect_nodes(desktop_t *d) {
+  if (!d) return 0;
+  d->column_count = 0;
+  if (!d->root) return 0;
+
+  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
+    if (!n->client || !scroller_is_tiled(n->client) || n->client->prev_in_stack)
+      continue;
+
+    if (d->column_count == d->column_capacity) {
+      int cap = d->column_capacity ? d->column_capacity * 2 : 16;
+      node_t **columns = realloc(d->columns, cap * sizeof(*columns));
+      if (!columns) return d->column_count;
+      d->columns = columns;
+      d->column_capacity = cap;
+    }
+    d->columns[d->column_count++] = n;
+  }
 
-  int count = 0;
-  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root))
-    if (n->client && scroller_is_tiled(n->client) && !n->client->prev_in_stack)
-      count++;
+  return d->column_count;
+}
 
-  if (count == 0) return 0;
+static int64_t now_msec(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-  node_t **nodes = calloc(count, sizeof(node_t*));
-  if (!nodes) return 0;
+// remaining offset of the strip, eased out
+static double scroll_offset_at(desktop_t *d, int64_t now) {
+  if (!d->scrolling || scroller_animation_duration <= 0)
+    return 0.0;
+  double t = (double)(now - d->scroll_start_msec) / scroller_animation_duration;
+  if (t >= 1.0)
+    return 0.0;
+  double ease = 1.0 - pow(1.0 - t, 3);
+  return d->scroll_from * (1.0 - ease);
+}
 
-  int idx = 0;
-  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root))
-    if (n->client && scroller_is_tiled(n->client) && !n->client->prev_in_stack)
-      nodes[idx++] = n;
+// every column moves under the pointer, hover and hit-test caches go stale
+static void set_scroll_offset(desktop_t *d, double offset) {
+  if (d->tile_tree == NULL)
+    return;
+  int x = (int)lround(offset);
+  if (d->tile_tree->node.x == x)
+    return;
+  wlr_scene_node_set_position(&d->tile_tree->node, x, 0);
+  spatial_invalidate();
+}
+
+static void stop_scroll(desktop_t *d) {
+  d->scrolling = false;
+  d->scroll_from = 0.0;
+  d->scroll_pending = 0;
+  d->scroll_queued = false;
+  set_scroll_offset(d, 0.0);
+}
+
+// the layout moved every column by delta, the slide starts once the
+// transaction carrying the new positions applies
+static void queue_scroll(desktop_t *d, int delta) {
+  if (scroller_animation_duration <= 0 || !desktop_is_visible(d)) {
+    if (d->scrolling || d->scroll_queued)
+      stop_scroll(d);
+    return;
+  }
+  if (delta == 0)
+    return;
+
+  d->scroll_pending += delta;
+  d->scroll_queued = true;
+}
+
+// the columns just landed, draw them where they were and let
+// scroller_animate slide them in. Only scene positions change so no
+// client sees a configure while it runs
+static void start_scroll(struct bwm_output *m, desktop_t *d, int delta) {
+  if (scroller_animation_duration <= 0 || !desktop_is_visible(d)) {
+    if (d->scrolling)
+      stop_scroll(d);
+    return;
+  }
 
-  *out_nodes = nodes;
-  return count;
+  int64_t now = now_msec();
+  double from = scroll_offset_at(d, now) + delta;
+  if (fabs(from) < 1.0) {
+    stop_scroll(d);
+    return;
+  }
+
+  d->scroll_from = from;
+  d->scroll_start_msec = now;
+  d->scrolling = true;
+  set_scroll_offset(d, from);
+  if (m != NULL && m->wlr_output)
+    wlr_output_schedule_frame(m->wlr_output);
+}
+
+// the rest of the strip moves in this frame, departing columns go with it
+static void apply_culling(desktop_t *d) {
+  d->cull_pending = false;
+  if (d->root == NULL)
+    return;
+
+  bool changed = false;
+  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root)) {
+    client_t *c = n->client;
+    if (c == NULL || !c->culled || c->shown)
+      continue;
+    struct wlr_scene_tree *scene_tree = client_get_scene_tree(c);
+    if (scene_tree && scene_tree->node.enabled) {
+      wlr_scene_node_set_enabled(&scene_tree->node, false);
+      changed = true;
+    }
+  }
+
+  if (changed)
+    spatial_invalidate();
+}
+
+void scroller_apply_scroll(desktop_t *d) {
+  if (d == NULL)
+    return;
+  if (d->cull_pending)
+    apply_culling(d);
+  if (!d->scroll_queued)
+    return;
+
+  int delta = d->scroll_pending;
+  d->scroll_pending = 0;
+  d->scroll_queued = false;
+  start_scroll(d->output, d, delta);
+}
+
+void scroller_animate(struct bwm_output *m) {
+  int64_t now = now_msec();
+  for (desktop_t *d = m->desk_head; d != NULL; d = d->next) {
+    if (!d->scrolling)
+      continue;
+    // hidden desktops and other layouts snap straight to their place
+    if (d != m->desk || d->layout != LAYOUT_SCROLLER ||
+        now - d->scroll_start_msec >= scroller_animation_duration) {
+      stop_scroll(d);
+      continue;
+    }
+
+    set_scroll_offset(d, scroll_offset_at(d, now));
+    wlr_output_schedule_frame(m->wlr_output);
+  }
 }
 
-static void scroller_arrange_stack(node_t *head_node, struct wlr_box base_geom, int gap, struct bwm_output *m) {
+// columns outside the viewport are hidden and only get a transaction when
+// their size changes, moving them needs no configure and nothing to render.
+// Their scene trees stay enabled until the transaction moving the rest of
+// the strip applies, see scroller_apply_scroll
+static void scroller_place(node_t *n, struct wlr_box geom, struct bwm_output *m, bool on_screen) {
+  client_t *c = n->client;
+  n->output = m;
+
+  if (on_screen) {
+    if (c->culled) {
+      c->culled = false;
+      c->shown = true;
+    }
+    node_set_pending_rectangle(n, geom);
+    return;
+  }
+
+  bool resized = n->pending.rectangle.width != geom.width ||
+    n->pending.rectangle.height != geom.height;
+
+  if (c->shown) {
+    c->culled = true;
+    c->shown = false;
+    if (n->desktop)
+      n->desktop->cull_pending = true;
+    spatial_invalidate();
+  }
+
+  n->pending.rectangle = geom;
+  if (resized)
+    node_set_dirty(n);
+}
+
+static void scroller_arrange_stack(node_t *head_node, struct wlr_box base_geom, int gap,
+                                   struct bwm_output *m, struct wlr_box viewport) {
   if (!head_node || !head_node->client) return;
 
   client_t *head = head_node->client;
+  struct wlr_box clip;
+  bool on_screen = wlr_box_intersection(&clip, &base_geom, &viewport);
 
   int count = 1;
   float total_proportion = head->stack_proportion;
@@ -93,9 +264,7 @@ static void scroller_arrange_stack(node_t *head_node, struct wlr_box base_geom,
 
     wlr_log(WLR_DEBUG, "scroller_arrange_stack: setting node %u geom=(%d,%d %dx%d)",
             head_node->id, r.x, r.y, r.width, r.height);
-    node_set_pending_rectangle(head_node, base_geom);
-    head_node->output = m;
-    node_set_dirty(head_node);
+    scroller_place(head_node, base_geom, m, on_screen);
     return;
   }
 
@@ -128,32 +297,18 @@ static void scroller_arrange_stack(node_t *head_node, struct wlr_box base_geom,
 
     c->tiled_rectangle = r;
 
-    node_t *stack_node = (c == head) ? head_node : NULL;
-    if (!stack_node) {
-      for (node_t *n = first_extrema(head_node->output->desk->root); n; n = next_leaf(n, head_node->output->desk->root)) {
-        if (n->client == c) {
-          stack_node = n;
-          break;
-        }
-      }
-    }
-
-    if (stack_node) {
-      node_set_pending_rectangle(stack_node, geom);
-      stack_node->output = m;
-      node_set_dirty(stack_node);
-    }
+    node_t *stack_node = (c == head) ? head_node : c->node;
+    if (stack_node && stack_node->desktop == head_node->desktop)
+      scroller_place(stack_node, geom, m, on_screen);
   }
 }
 
-void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box available) {
-  if (!d || !d->root) return;
-
+static void arrange_columns(struct bwm_output *m, desktop_t *d, struct wlr_box available) {
   wlr_log(WLR_DEBUG, "scroller_arrange: starting, available=(%d,%d %dx%d)",
           available.x, available.y, available.width, available.height);
 
-  node_t **nodes = NULL;
-  int n = scroller_collect_nodes(d, &nodes);
+  int n = scroller_collect_nodes(d);
+  node_t **nodes = d->columns;
   wlr_log(WLR_DEBUG, "scroller_arrange: found %d tiled nodes", n);
   if (n == 0) return;
 
@@ -214,10 +369,8 @@ void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box availab
   if (!focused_node)
     focused_node = nodes[0];
 
-  if (!focused_node) {
-    free(nodes);
+  if (!focused_node)
     return;
-  }
 
   client_t *focused = focused_node->client;
 
@@ -235,8 +388,9 @@ void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box availab
 
     wlr_log(WLR_DEBUG, "scroller_arrange: single window geom=(%d,%d %dx%d)",
             geom.x, geom.y, geom.width, geom.height);
-    scroller_arrange_stack(focused_node, geom, gappiv, m);
-    free(nodes);
+    if (d->scrolling || d->scroll_queued)
+      stop_scroll(d);
+    scroller_arrange_stack(focused_node, geom, gappiv, m, available);
     return;
   }
 
@@ -264,7 +418,27 @@ void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box availab
     focused_geom.x = available.x + scroller_structs;
   }
 
-  scroller_arrange_stack(focused_node, focused_geom, gappiv, m);
+  // a pure scroll moves the focused column without resizing it, animate
+  // the strip by that distance
+  int old_width = focused->tiled_rectangle.width + 2 * (int)focused->border_width;
+  if (focused->tiled_rectangle.width > 0 && old_width == focused_geom.width)
+    queue_scroll(d, focused->tiled_rectangle.x - (int)focused->border_width - focused_geom.x);
+  else if (d->scrolling || d->scroll_queued)
+    stop_scroll(d);
+
+  // columns passing through the viewport while sliding stay visible, the
+  // strip is drawn anywhere between the current and the queued offset
+  struct wlr_box viewport = available;
+  if (d->scrolling || d->scroll_queued) {
+    double current = d->scrolling ? d->scroll_from : 0.0;
+    double queued = current + d->scroll_pending;
+    int lo = (int)floor(fmin(0.0, fmin(current, queued)));
+    int hi = (int)ceil(fmax(0.0, fmax(current, queued)));
+    viewport.x -= hi;
+    viewport.width += hi - lo;
+  }
+
+  scroller_arrange_stack(focused_node, focused_geom, gappiv, m, viewport);
 
   for (int i = 1; i <= focus_idx; i++) {
     node_t *node = nodes[focus_idx - i];
@@ -277,7 +451,7 @@ void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box availab
     node_t *next_node = nodes[focus_idx - i + 1];
     geom.x = next_node->client->tiled_rectangle.x - gappih - geom.width;
 
-    scroller_arrange_stack(node, geom, gappiv, m);
+    scroller_arrange_stack(node, geom, gappiv, m, viewport);
   }
 
   for (int i = 1; i < n - focus_idx; i++) {
@@ -291,10 +465,23 @@ void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box availab
     node_t *prev_node = nodes[focus_idx + i - 1];
     geom.x = prev_node->client->tiled_rectangle.x + prev_node->client->tiled_rectangle.width + gappih;
 
-    scroller_arrange_stack(node, geom, gappiv, m);
+    scroller_arrange_stack(node, geom, gappiv, m, viewport);
   }
+}
+
+void scroller_arrange(struct bwm_output *m, desktop_t *d, struct wlr_box available) {
+  if (!d || !d->root) return;
 
-  free(nodes);
+  arrange_columns(m, d, available);
+  if (!d->cull_pending)
+    return;
+
+  // with no window of the desktop moving or waiting on a transaction,
+  // nothing would hide the culled columns later
+  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root))
+    if (n->dirty || n->ntxnrefs > 0)
+      return;
+  apply_culling(d);
 }
 
 void scroller_stack_push(client_t *head, client_t *new_client) {
@@ -450,8 +637,8 @@ bool scroller_focus_next(desktop_t *d) {
 
   client_t *current = scroller_get_stack_head(d->focus->client);
 
-  node_t **nodes = NULL;
-  int n = scroller_collect_nodes(d, &nodes);
+  int n = scroller_collect_nodes(d);
+  node_t **nodes = d->columns;
   if (n == 0) return false;
 
   int current_idx = -1;
@@ -462,14 +649,11 @@ bool scroller_focus_next(desktop_t *d) {
     }
   }
 
-  bool result = false;
   if (current_idx >= 0 && current_idx < n - 1) {
     d->focus = nodes[current_idx + 1];
-    result = true;
+    return true;
   }
-
-  free(nodes);
-  return result;
+  return false;
 }
 
 bool scroller_focus_prev(desktop_t *d) {
@@ -477,8 +661,8 @@ bool scroller_focus_prev(desktop_t *d) {
 
   client_t *current = scroller_get_stack_head(d->focus->client);
 
-  node_t **nodes = NULL;
-  int n = scroller_collect_nodes(d, &nodes);
+  int n = scroller_collect_nodes(d);
+  node_t **nodes = d->columns;
   if (n == 0) return false;
 
   int current_idx = -1;
@@ -489,44 +673,31 @@ bool scroller_focus_prev(desktop_t *d) {
     }
   }
 
-  bool result = false;
   if (current_idx > 0) {
     d->focus = nodes[current_idx - 1];
-    result = true;
+    return true;
   }
-
-  free(nodes);
-  return result;
+  return false;
 }
 
 bool scroller_focus_down(desktop_t *d) {
   if (!d || !d->focus || !d->focus->client) return false;
 
   client_t *current = d->focus->client;
-  if (!current->next_in_stack) return false;
-
-  for (node_t *n = first_extrema(d->root); n; n = next_leaf(n, d->root)) {
-    if (n->client == current->next_in_stack) {
-      d->focus = n;
-      return true;
-    }
-  }
+  node_t *target = current->next_in_stack ? current->next_in_stack->node : NULL;
+  if (!target || target->desktop != d) return false;
 
-  return false;
+  d->focus = target;
+  return true;
 }
 
 bool scroller_focus_up(desktop_t *d) {
   if (!d || !d->focus || !d->focus->client) return false;
 
   client_t *current = d->focus->client;
-  if (!current->prev_in_stack) return false;
+  node_t *target = current->prev_in_stack ? current->prev_in_stack->node : NULL;
+  if (!target || target->desktop != d) return false;
 
-  for (node_t *n = first_extrema(d->root); n; n = next_leaf(n, d->root)) {
-    if (n->client == current->prev_in_stack) {
-      d->focus = n;
-      return true;
-    }
-  }
-
-  return false;
+  d->focus = target;
+  return true;
 }
@@ -16,6 +16,10 @@
 #include "keyboard.h"
 #include "xwayland.h"
 #include "blur.h"
+#include "spatial.h"
+#include "tree.h"
+#include "text.h"
+#include "animation.h"
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -612,6 +616,11 @@ void server_fini(void) {
   }
 
   transaction_fini();
+  spatial_fini();
+  animation_fini();
+  tree_fini();
+  output_fini();
+  text_fini();
   workspace_fini();
   ipc_cleanup();
   rule_fini();
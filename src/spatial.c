@@ -0,0 +1,407 @@
+#include "spatial.h"
+#include "server.h"
+#include "toplevel.h"
+#include "tree.h"
+#include "output.h"
+#include "xwayland.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/util/log.h>
+
+// hit-test grid resolution per output
+#define GRID_DIM 8
+#define GRID_CELLS (GRID_DIM * GRID_DIM)
+
+// per-output bucket grid of tiled window frames
+struct spatial_grid {
+  struct bwm_output *output;
+  struct wlr_box area;
+  size_t cell_start[GRID_CELLS + 1];
+  size_t *cell_entries;
+  size_t cell_capacity;
+};
+
+// entries plus one ordering per direction, sorted by the edge facing it
+static struct {
+  struct bwm_spatial_entry *entries;
+  size_t count;
+  size_t capacity;
+  size_t *order[4];
+  struct spatial_grid *grids;
+  size_t grid_count;
+  size_t grid_capacity;
+  bool dirty;
+  uint32_t generation;
+} index_state = {.dirty = true};
+
+void spatial_invalidate(void) {
+  index_state.dirty = true;
+  index_state.generation++;
+}
+
+uint32_t spatial_generation(void) {
+  return index_state.generation;
+}
+
+struct wlr_box spatial_node_box(node_t *n) {
+  struct wlr_box box = {0};
+  if (n == NULL)
+    return box;
+  if (n->client == NULL)
+    return n->rectangle;
+
+  if (n->client->state == STATE_FULLSCREEN && n->output)
+    return n->output->rectangle;
+  if (IS_FLOATING(n->client))
+    return n->client->floating_rectangle;
+  return n->client->tiled_rectangle;
+}
+
+static bool node_visible(node_t *n) {
+  if (n == NULL || n->client == NULL || n->destroying)
+    return false;
+  return n->output != NULL && node_on_screen(n);
+}
+
+static void add_entry(node_t *n) {
+  if (!node_visible(n))
+    return;
+
+  struct wlr_box box = spatial_node_box(n);
+  if (box.width <= 0 || box.height <= 0)
+    return;
+
+  if (index_state.count >= index_state.capacity) {
+    size_t cap = index_state.capacity == 0 ? 32 : index_state.capacity * 2;
+    struct bwm_spatial_entry *entries =
+      realloc(index_state.entries, cap * sizeof(*entries));
+    if (entries == NULL)
+      return;
+    index_state.entries = entries;
+    for (int i = 0; i < 4; i++) {
+      size_t *order = realloc(index_state.order[i], cap * sizeof(*order));
+      if (order == NULL)
+        return;
+      index_state.order[i] = order;
+    }
+    index_state.capacity = cap;
+  }
+
+  struct bwm_spatial_entry *e = &index_state.entries[index_state.count];
+  e->node = n;
+  e->output = n->output;
+  e->box = box;
+  for (int i = 0; i < 4; i++)
+    index_state.order[i][index_state.count] = index_state.count;
+  index_state.count++;
+}
+
+// edge of a box that faces the direction of travel
+static int leading_edge(const struct wlr_box *b, direction_t dir) {
+  switch (dir) {
+  case DIR_WEST:
+    return -(b->x + b->width);
+  case DIR_EAST:
+    return b->x;
+  case DIR_NORTH:
+    return -(b->y + b->height);
+  case DIR_SOUTH:
+    return b->y;
+  }
+  return 0;
+}
+
+static direction_t sort_dir;
+
+static int compare_entries(const void *a, const void *b) {
+  int ea = leading_edge(&index_state.entries[*(const size_t *)a].box, sort_dir);
+  int eb = leading_edge(&index_state.entries[*(const size_t *)b].box, sort_dir);
+  return (ea > eb) - (ea < eb);
+}
+
+static bool entry_is_tiled(struct bwm_spatial_entry *e) {
+  client_t *c = e->node->client;
+  return c->state != STATE_FULLSCREEN && !IS_FLOATING(c);
+}
+
+// frame including borders, this is what the scene tree covers
+static struct wlr_box entry_frame(struct bwm_spatial_entry *e) {
+  struct wlr_box b = e->box;
+  int bw = (int)e->node->client->border_width;
+  b.x -= bw;
+  b.y -= bw;
+  b.width += 2 * bw;
+  b.height += 2 * bw;
+  return b;
+}
+
+// cell range covered by box, false when it misses the grid
+static bool grid_span(struct spatial_grid *g, const struct wlr_box *b,
+                      int *x0, int *y0, int *x1, int *y1) {
+  struct wlr_box clip;
+  if (!wlr_box_intersection(&clip, &g->area, b))
+    return false;
+
+  *x0 = (clip.x - g->area.x) * GRID_DIM / g->area.width;
+  *y0 = (clip.y - g->area.y) * GRID_DIM / g->area.height;
+  *x1 = (clip.x + clip.width - 1 - g->area.x) * GRID_DIM / g->area.width;
+  *y1 = (clip.y + clip.height - 1 - g->area.y) * GRID_DIM / g->area.height;
+  return true;
+}
+
+static void build_grid(struct spatial_grid *g) {
+  memset(g->cell_start, 0, sizeof(g->cell_start));
+
+  // count entries per cell, shifted by one for the prefix sum
+  for (size_t i = 0; i < index_state.count; i++) {
+    struct bwm_spatial_entry *e = &index_state.entries[i];
+    if (e->output != g->output || !entry_is_tiled(e))
+      continue;
+    struct wlr_box frame = entry_frame(e);
+    int x0, y0, x1, y1;
+    if (!grid_span(g, &frame, &x0, &y0, &x1, &y1))
+      continue;
+    for (int y = y0; y <= y1; y++)
+      for (int x = x0; x <= x1; x++)
+        g->cell_start[y * GRID_DIM + x + 1]++;
+  }
+
+  for (int c = 0; c < GRID_CELLS; c++)
+    g->cell_start[c + 1] += g->cell_start[c];
+
+  size_t total = g->cell_start[GRID_CELLS];
+  if (total > g->cell_capacity) {
+    size_t *cells = realloc(g->cell_entries, total * sizeof(*cells));
+    if (cells == NULL) {
+      memset(g->cell_start, 0, sizeof(g->cell_start));
+      return;
+    }
+    g->cell_entries = cells;
+    g->cell_capacity = total;
+  }
+
+  size_t fill[GRID_CELLS];
+  memcpy(fill, g->cell_start, sizeof(fill));
+  for (size_t i = 0; i < index_state.count; i++) {
+    struct bwm_spatial_entry *e = &index_state.entries[i];
+    if (e->output != g->output || !entry_is_tiled(e))
+      continue;
+    struct wlr_box frame = entry_frame(e);
+    int x0, y0, x1, y1;
+    if (!grid_span(g, &frame, &x0, &y0, &x1, &y1))
+      continue;
+    for (int y = y0; y <= y1; y++)
+      for (int x = x0; x <= x1; x++)
+        g->cell_entries[fill[y * GRID_DIM + x]++] = i;
+  }
+}
+
+static void rebuild_grids(void) {
+  index_state.grid_count = 0;
+
+  for (struct bwm_output *m = mon_head; m != NULL; m = m->next) {
+    if (m->rectangle.width <= 0 || m->rectangle.height <= 0)
+      continue;
+
+    if (index_state.grid_count >= index_state.grid_capacity) {
+      size_t cap = index_state.grid_capacity == 0 ? 4 : index_state.grid_capacity * 2;
+      struct spatial_grid *grids = realloc(index_state.grids, cap * sizeof(*grids));
+      if (grids == NULL)
+        return;
+      memset(grids + index_state.grid_capacity, 0,
+             (cap - index_state.grid_capacity) * sizeof(*grids));
+      index_state.grids = grids;
+      index_state.grid_capacity = cap;
+    }
+
+    struct spatial_grid *g = &index_state.grids[index_state.grid_count++];
+    g->output = m;
+    g->area = m->rectangle;
+    build_grid(g);
+  }
+}
+
+static void rebuild(void) {
+  index_state.count = 0;
+
+  struct bwm_toplevel *toplevel;
+  wl_list_for_each(toplevel, &server.toplevels, link)
+    add_entry(toplevel->node);
+
+  struct bwm_xwayland_view *view;
+  wl_list_for_each(view, &server.xwayland.views, link)
+    add_entry(view->node);
+
+  for (int i = 0; i < 4; i++) {
+    sort_dir = (direction_t)i;
+    qsort(index_state.order[i], index_state.count, sizeof(size_t), compare_entries);
+  }
+
+  rebuild_grids();
+
+  index_state.dirty = false;
+  wlr_log(WLR_DEBUG, "spatial: rebuilt index with %zu windows", index_state.count);
+}
+
+// gap between [a0, a1) and [b0, b1), 0 when they overlap
+static int interval_gap(int a0, int a1, int b0, int b1) {
+  if (b1 <= a0)
+    return a0 - b1;
+  if (a1 <= b0)
+    return b0 - a1;
+  return 0;
+}
+
+node_t *spatial_nearest(node_t *n, direction_t dir, bool tiled_only,
+                        struct bwm_output **out_output) {
+  if (n == NULL)
+    return NULL;
+
+  if (index_state.dirty)
+    rebuild();
+
+  struct wlr_box from = spatial_node_box(n);
+  bool horizontal = dir == DIR_WEST || dir == DIR_EAST;
+
+  // tighter settings penalize windows that are offset sideways
+  double perp_weight = 1.0 + directional_focus_tightness / 25.0;
+
+  // candidates must have their leading edge past ours, distance is
+  // measured from our far edge
+  int from_lead = leading_edge(&from, dir);
+  int from_trail;
+  switch (dir) {
+  case DIR_WEST:
+    from_trail = -from.x;
+    break;
+  case DIR_EAST:
+    from_trail = from.x + from.width;
+    break;
+  case DIR_NORTH:
+    from_trail = -from.y;
+    break;
+  default:
+    from_trail = from.y + from.height;
+    break;
+  }
+
+  size_t *order = index_state.order[dir];
+
+  // binary search for the first window whose leading edge is past ours
+  size_t lo = 0, hi = index_state.count;
+  while (lo < hi) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (leading_edge(&index_state.entries[order[mid]].box, dir) <= from_lead)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  struct bwm_spatial_entry *best = NULL;
+  double best_score = 0.0;
+
+  for (size_t i = lo; i < index_state.count; i++) {
+    struct bwm_spatial_entry *e = &index_state.entries[order[i]];
+    int lead = leading_edge(&e->box, dir);
+
+    // leading edges only grow from here, so no later entry can do better
+    double primary = lead > from_trail ? lead - from_trail : 0;
+    if (best != NULL && primary >= best_score)
+      break;
+
+    if (e->node == n || !node_visible(e->node))
+      continue;
+    if (tiled_only && !IS_TILED(e->node->client))
+      continue;
+
+    int perp = horizontal
+      ? interval_gap(from.y, from.y + from.height, e->box.y, e->box.y + e->box.height)
+      : interval_gap(from.x, from.x + from.width, e->box.x, e->box.x + e->box.width);
+
+    double score = primary + perp_weight * perp;
+    if (best == NULL || score < best_score) {
+      best = e;
+      best_score = score;
+    }
+  }
+
+  if (best == NULL)
+    return NULL;
+
+  if (out_output)
+    *out_output = best->output;
+  return best->node;
+}
+
+// columns of a sliding scroller strip are drawn off their layout position,
+// the grid only covers layout positions on the output
+static node_t *scan_tiled_at(struct bwm_output *m, int px, int py) {
+  for (size_t i = 0; i < index_state.count; i++) {
+    struct bwm_spatial_entry *e = &index_state.entries[i];
+    if (e->output != m || !entry_is_tiled(e))
+      continue;
+    struct wlr_box frame = entry_frame(e);
+    if (wlr_box_contains_point(&frame, px, py) && node_visible(e->node))
+      return e->node;
+  }
+  return NULL;
+}
+
+node_t *spatial_tiled_at(double lx, double ly) {
+  if (index_state.dirty)
+    rebuild();
+
+  int px = (int)floor(lx), py = (int)floor(ly);
+
+  for (size_t i = 0; i < index_state.grid_count; i++) {
+    struct spatial_grid *g = &index_state.grids[i];
+    if (!wlr_box_contains_point(&g->area, px, py))
+      continue;
+
+    // hit-test where the tiles are drawn, the tile layer carries the
+    // scroller's animation offset
+    desktop_t *d = g->output->desk;
+    if (d != NULL && d->tile_tree != NULL && d->tile_tree->node.x != 0) {
+      int sx = px - d->tile_tree->node.x;
+      if (!wlr_box_contains_point(&g->area, sx, py))
+        return scan_tiled_at(g->output, sx, py);
+      px = sx;
+    }
+
+    int cx = (px - g->area.x) * GRID_DIM / g->area.width;
+    int cy = (py - g->area.y) * GRID_DIM / g->area.height;
+    int c = cy * GRID_DIM + cx;
+
+    for (size_t k = g->cell_start[c]; k < g->cell_start[c + 1]; k++) {
+      struct bwm_spatial_entry *e = &index_state.entries[g->cell_entries[k]];
+      struct wlr_box frame = entry_frame(e);
+      if (wlr_box_contains_point(&frame, px, py) && node_visible(e->node))
+        return e->node;
+    }
+    return NULL;
+  }
+
+  return NULL;
+}
+
+void spatial_fini(void) {
+  free(index_state.entries);
+  index_state.entries = NULL;
+  for (int i = 0; i < 4; i++) {
+    free(index_state.order[i]);
+    index_state.order[i] = NULL;
+  }
+  index_state.count = 0;
+  index_state.capacity = 0;
+
+  for (size_t i = 0; i < index_state.grid_capacity; i++)
+    free(index_state.grids[i].cell_entries);
+  free(index_state.grids);
+  index_state.grids = NULL;
+  index_state.grid_count = 0;
+  index_state.grid_capacity = 0;
+
+  index_state.dirty = true;
+}
@@ -54,10 +54,6 @@ static size_t collect_leaves(node_t *n, node_t **out, size_t cap) {
   return used;
 }
 
-static size_t count_leaves(node_t *n) {
-	return collect_leaves(n, NULL, 0);
-}
-
 node_t *tab_focus_leaf(node_t *tabbed_node, node_t *focus) {
   if (tabbed_node == NULL)
     return NULL;
@@ -75,42 +71,50 @@ node_t *tab_focus_leaf(node_t *tabbed_node, node_t *focus) {
   return first;
 }
 
-node_t *tab_next_leaf(node_t *tabbed_node, node_t *focus) {
-  if (tabbed_node == NULL)
+// a tab neighbour straight from the bar entries when they are current
+static node_t *entry_step(node_t *tabbed_node, node_t *cur, bool forward) {
+  struct bwm_tab_bar *bar = tabbed_node->tab_bar;
+  if (bar == NULL || bar->dirty || bar->entry_count == 0)
     return NULL;
-  size_t n = count_leaves(tabbed_node);
-  if (n == 0)
+  if (bar->active_index >= bar->entry_count || bar->entries[bar->active_index].leaf != cur)
     return NULL;
-  node_t **arr = calloc(n, sizeof(node_t *));
-  if (!arr)
-    return NULL;
-  collect_leaves(tabbed_node, arr, n);
-  node_t *cur = tab_focus_leaf(tabbed_node, focus);
-  size_t idx = 0;
-  for (size_t i = 0; i < n; i++)
-    if (arr[i] == cur) { idx = i; break; }
-  node_t *res = arr[(idx + 1) % n];
-  free(arr);
-  return res;
+
+  size_t n = bar->entry_count;
+  size_t idx = forward ? (bar->active_index + 1) % n : (bar->active_index + n - 1) % n;
+  return bar->entries[idx].leaf;
 }
 
-node_t *tab_prev_leaf(node_t *tabbed_node, node_t *focus) {
+static bool is_tab_leaf(node_t *n) {
+  return n->client != NULL && n->client->state != STATE_FLOATING;
+}
+
+static node_t *tab_step(node_t *tabbed_node, node_t *focus, bool forward) {
   if (tabbed_node == NULL)
     return NULL;
-  size_t n = count_leaves(tabbed_node);
-  if (n == 0)
-    return NULL;
-  node_t **arr = calloc(n, sizeof(node_t *));
-  if (!arr)
-    return NULL;
-  collect_leaves(tabbed_node, arr, n);
   node_t *cur = tab_focus_leaf(tabbed_node, focus);
-  size_t idx = 0;
-  for (size_t i = 0; i < n; i++)
-    if (arr[i] == cur) { idx = i; break; }
-  node_t *res = arr[(idx + n - 1) % n];
-  free(arr);
-  return res;
+  if (cur == NULL)
+    return NULL;
+
+  node_t *res = entry_step(tabbed_node, cur, forward);
+  if (res != NULL)
+    return res;
+
+  // otherwise walk the group in leaf order, wrapping at either end
+  node_t *n = cur;
+  do {
+    n = forward ? next_leaf(n, tabbed_node) : prev_leaf(n, tabbed_node);
+    if (n == NULL)
+      n = forward ? first_extrema(tabbed_node) : second_extrema(tabbed_node);
+  } while (n != cur && !is_tab_leaf(n));
+  return n;
+}
+
+node_t *tab_next_leaf(node_t *tabbed_node, node_t *focus) {
+  return tab_step(tabbed_node, focus, true);
+}
+
+node_t *tab_prev_leaf(node_t *tabbed_node, node_t *focus) {
+  return tab_step(tabbed_node, focus, false);
 }
 
 static const char *leaf_label(node_t *leaf) {
@@ -123,51 +127,114 @@ static const char *leaf_label(node_t *leaf) {
   return "(untitled)";
 }
 
+static void destroy_entry(struct bwm_tab_entry *e) {
+  if (e->tree)
+    wlr_scene_node_destroy(&e->tree->node);
+  memset(e, 0, sizeof(*e));
+}
+
 static void destroy_entries(struct bwm_tab_bar *bar) {
   if (bar == NULL || bar->entries == NULL)
     return;
   for (size_t i = 0; i < bar->entry_count; i++)
-    if (bar->entries[i].tree)
-      wlr_scene_node_destroy(&bar->entries[i].tree->node);
+    destroy_entry(&bar->entries[i]);
   free(bar->entries);
   bar->entries = NULL;
   bar->entry_count = 0;
+  bar->entry_capacity = 0;
 }
 
-static void build_entries(struct bwm_tab_bar *bar) {
-  destroy_entries(bar);
+static void create_entry(struct bwm_tab_bar *bar, struct bwm_tab_entry *e, node_t *leaf) {
+  memset(e, 0, sizeof(*e));
+  e->leaf = leaf;
 
-  size_t count = count_leaves(bar->owner);
-  if (count == 0)
+  e->tree = wlr_scene_tree_create(bar->tree);
+  if (!e->tree)
     return;
 
-  bar->entries = calloc(count, sizeof(struct bwm_tab_entry));
-  if (!bar->entries)
-    return;
+  bool is_active = leaf == bar->active;
+  e->bg = wlr_scene_rect_create(e->tree, 1, 1,
+    is_active ? color_tab_bg_active : color_tab_bg);
+  e->border = wlr_scene_rect_create(e->tree, 1, TAB_BAR_BORDER, color_tab_sep);
+
+  float text_color[4];
+  memcpy(text_color, is_active ? color_tab_text_active : color_tab_text,
+    sizeof(text_color));
+  e->label = bwm_text_node_create(e->tree, leaf_label(leaf), text_color, false);
+}
+
+static bool reserve_entries(struct bwm_tab_bar *bar, size_t count) {
+  if (count <= bar->entry_capacity)
+    return true;
+  size_t cap = bar->entry_capacity ? bar->entry_capacity * 2 : 8;
+  while (cap < count)
+    cap *= 2;
+  struct bwm_tab_entry *entries = realloc(bar->entries, cap * sizeof(*entries));
+  if (!entries)
+    return false;
+  bar->entries = entries;
+  bar->entry_capacity = cap;
+  return true;
+}
+
+// leaf order of the group, reused between rebuilds
+static node_t **scratch_leaves;
+static size_t scratch_capacity;
 
-  node_t **leaves = calloc(count, sizeof(node_t *));
+static size_t gather_leaves(node_t *owner) {
+  size_t count = collect_leaves(owner, scratch_leaves, scratch_capacity);
+  if (count <= scratch_capacity)
+    return count;
+
+  node_t **leaves = realloc(scratch_leaves, count * sizeof(*leaves));
   if (!leaves)
+    return 0;
+  scratch_leaves = leaves;
+  scratch_capacity = count;
+  return collect_leaves(owner, scratch_leaves, scratch_capacity);
+}
+
+// match the entries against the current leaves, surviving leaves keep their
+// scene nodes and labels, only added and removed tabs are touched
+static void build_entries(struct bwm_tab_bar *bar) {
+  size_t count = gather_leaves(bar->owner);
+  if (!reserve_entries(bar, count))
     return;
-  collect_leaves(bar->owner, leaves, count);
 
+  // [0, i) is final, [i, entry_count) are old entries not yet matched
   for (size_t i = 0; i < count; i++) {
-    struct bwm_tab_entry *e = &bar->entries[i];
-    e->leaf = leaves[i];
-
-    e->tree = wlr_scene_tree_create(bar->tree);
-    if (!e->tree)
+    node_t *leaf = scratch_leaves[i];
+
+    size_t j = i;
+    while (j < bar->entry_count && bar->entries[j].leaf != leaf)
+      j++;
+
+    if (j < bar->entry_count) {
+      struct bwm_tab_entry tmp = bar->entries[i];
+      bar->entries[i] = bar->entries[j];
+      bar->entries[j] = tmp;
+      if (bar->entries[i].label)
+        bwm_text_node_set_text(bar->entries[i].label, leaf_label(leaf));
       continue;
+    }
 
-    e->bg = wlr_scene_rect_create(e->tree, 1, 1, color_tab_bg);
-    e->border = wlr_scene_rect_create(e->tree, 1, TAB_BAR_BORDER, color_tab_sep);
-
-    float text_color[4];
-    memcpy(text_color, color_tab_text, sizeof(text_color));
-    e->label = bwm_text_node_create(e->tree, leaf_label(leaves[i]), text_color, false);
+    if (i < bar->entry_count) {
+      if (!reserve_entries(bar, bar->entry_count + 1))
+        return;
+      bar->entries[bar->entry_count++] = bar->entries[i];
+    } else {
+      bar->entry_count++;
+    }
+    create_entry(bar, &bar->entries[i], leaf);
   }
 
-  free(leaves);
+  for (size_t i = count; i < bar->entry_count; i++)
+    destroy_entry(&bar->entries[i]);
   bar->entry_count = count;
+
+  for (size_t i = 0; i < count; i++)
+    if (bar->entries[i].leaf == bar->active)
+      bar->active_index = i;
 }
 
 void tabs_create(node_t *n) {
@@ -181,7 +248,10 @@ void tabs_create(node_t *n) {
     return;
   bar->owner = n;
 
-  bar->tree = wlr_scene_tree_create(server.tile_tree);
+  // internal nodes don't track a desktop, their leaves do
+  node_t *leaf = first_extrema(n);
+  bar->tree = wlr_scene_tree_create(desktop_layer(leaf ? leaf->desktop : NULL,
+                                                  server.tile_tree));
   if (!bar->tree) {
     free(bar);
     return;
@@ -206,11 +276,24 @@ void tabs_destroy(node_t *n) {
 void tabs_rebuild(node_t *n) {
   if (n == NULL || n->tab_bar == NULL)
     return;
-  build_entries(n->tab_bar);
+  n->tab_bar->dirty = true;
+  n->tab_bar->recolor = true;
   tabs_arrange(n, n->tab_bar->rect);
   tabs_update_focus(n, NULL);
 }
 
+void tabs_mark_dirty(node_t *n) {
+  if (n == NULL || n->tab_bar == NULL)
+    return;
+  n->tab_bar->dirty = true;
+}
+
+void tabs_mark_ancestors_dirty(node_t *n) {
+  for (node_t *p = n ? n->parent : NULL; p != NULL; p = p->parent)
+    if (p->split_type == TYPE_TABBED)
+      tabs_mark_dirty(p);
+}
+
 void tabs_arrange(node_t *n, struct wlr_box rect) {
   if (n == NULL || n->tab_bar == NULL)
     return;
@@ -220,6 +303,11 @@ void tabs_arrange(node_t *n, struct wlr_box rect) {
   if (bar->tree == NULL)
     return;
 
+  if (bar->dirty) {
+    bar->dirty = false;
+    build_entries(bar);
+  }
+
   wlr_scene_node_set_position(&bar->tree->node, rect.x, rect.y);
 
   if (bar->bg)
@@ -279,9 +367,17 @@ void tabs_update_focus(node_t *n, node_t *focus) {
   if (n == NULL || n->tab_bar == NULL)
     return;
 
+  struct bwm_tab_bar *bar = n->tab_bar;
   node_t *active = tab_focus_leaf(n, focus);
-  for (size_t i = 0; i < n->tab_bar->entry_count; i++) {
-    struct bwm_tab_entry *e = &n->tab_bar->entries[i];
+  if (active == bar->active && !bar->recolor)
+    return;
+
+  for (size_t i = 0; i < bar->entry_count; i++) {
+    struct bwm_tab_entry *e = &bar->entries[i];
+    if (e->leaf == active)
+      bar->active_index = i;
+    if (!bar->recolor && e->leaf != bar->active && e->leaf != active)
+      continue;
     bool is_active = (e->leaf == active);
     if (e->bg)
       wlr_scene_rect_set_color(e->bg, is_active ? color_tab_bg_active : color_tab_bg);
@@ -291,6 +387,9 @@ void tabs_update_focus(node_t *n, node_t *focus) {
       bwm_text_node_set_color(e->label, c);
     }
   }
+
+  bar->active = active;
+  bar->recolor = false;
 }
 
 void tabs_update_label_for_leaf(node_t *leaf) {
@@ -311,6 +410,9 @@ node_t *tabs_hit_test(node_t *n, double lx, double ly) {
     return NULL;
   if (!n->tab_bar->tree->node.enabled)
     return NULL;
+  // entries may still point at removed leaves until the next arrange
+  if (n->tab_bar->dirty)
+    tabs_arrange(n, n->tab_bar->rect);
   for (size_t i = 0; i < n->tab_bar->entry_count; i++) {
     struct bwm_tab_entry *e = &n->tab_bar->entries[i];
     if (e->leaf == NULL || e->leaf->destroying)
@@ -1,4 +1,5 @@
 #include "text.h"
+#include "hash.h"
 
 #include <cairo.h>
 #include <drm_fourcc.h>
@@ -52,6 +53,22 @@ static const struct wlr_buffer_impl cairo_buffer_impl = {
   .end_data_ptr_access = cairo_buffer_end_data_ptr_access,
 };
 
+// a label rendered in one color state at one scale, tab labels flip
+// between the active and inactive colors on every focus change and
+// between output scales when moved across outputs
+#define TEXT_SHADES 4
+
+struct text_shade {
+  struct wlr_buffer *buffer;
+  float color[4];
+  float background[4];
+  int width;
+  int height;
+  float scale;
+  uint32_t font_serial;
+  uint64_t last_used;
+};
+
 struct bwm_text_buffer {
   struct wlr_scene_buffer *buffer_node;
   char *text;
@@ -60,10 +77,53 @@ struct bwm_text_buffer {
   bool visible;
   float scale;
 
+  struct text_shade shades[TEXT_SHADES];
+
   struct wl_listener outputs_update;
   struct wl_listener destroy;
 };
 
+// shaped layouts and rasterized labels are shared between text nodes,
+// tab bars repeat the same few titles and colors a lot. Layouts do not
+// depend on the scale, rasters are kept per scale
+#define LAYOUT_CACHE_SIZE 64
+#define RASTER_CACHE_SIZE 64
+
+struct layout_entry {
+  char *text;
+  uint32_t hash;
+  bool pango_markup;
+  int width;
+  PangoLayout *layout;
+  int pixel_width;
+  int baseline;
+  uint64_t last_used;
+};
+
+struct raster_entry {
+  char *text;
+  uint32_t hash;
+  bool pango_markup;
+  int width;
+  int height;
+  float scale;
+  float color[4];
+  float background[4];
+  struct wlr_buffer *buffer;
+  uint64_t last_used;
+};
+
+// one pango context and one parsed font, reparsed when text_font changes
+static struct {
+  PangoContext *context;
+  PangoFontDescription *font;
+  char font_name[sizeof(text_font)];
+  uint32_t font_serial;
+  uint64_t clock;
+  struct layout_entry layouts[LAYOUT_CACHE_SIZE];
+  struct raster_entry rasters[RASTER_CACHE_SIZE];
+} text_state;
+
 int bwm_text_node_default_height(void) { return text_height; }
 
 static int get_text_width(const struct bwm_text_node *props) {
@@ -75,12 +135,49 @@ static int get_text_width(const struct bwm_text_node *props) {
   return width;
 }
 
-static PangoLayout *make_pango_layout(cairo_t *cairo, const char *text,
-		bool pango_markup) {
-  PangoLayout *layout = pango_cairo_create_layout(cairo);
-  PangoFontDescription *desc = pango_font_description_from_string(text_font);
-  pango_layout_set_font_description(layout, desc);
-  pango_font_description_free(desc);
+static void layout_entry_clear(struct layout_entry *e) {
+  if (e->layout)
+    g_object_unref(e->layout);
+  free(e->text);
+  memset(e, 0, sizeof(*e));
+}
+
+static void raster_entry_clear(struct raster_entry *e) {
+  if (e->buffer)
+    wlr_buffer_unlock(e->buffer);
+  free(e->text);
+  memset(e, 0, sizeof(*e));
+}
+
+static void text_cache_flush(void) {
+  for (size_t i = 0; i < LAYOUT_CACHE_SIZE; i++)
+    layout_entry_clear(&text_state.layouts[i]);
+  for (size_t i = 0; i < RASTER_CACHE_SIZE; i++)
+    raster_entry_clear(&text_state.rasters[i]);
+}
+
+static bool text_state_update(void) {
+  if (text_state.context == NULL) {
+    text_state.context = pango_font_map_create_context(pango_cairo_font_map_get_default());
+    if (text_state.context == NULL)
+      return false;
+  }
+
+  if (text_state.font == NULL || strcmp(text_state.font_name, text_font) != 0) {
+    // cached shapes and pixels belong to the old font
+    text_cache_flush();
+    if (text_state.font)
+      pango_font_description_free(text_state.font);
+    text_state.font = pango_font_description_from_string(text_font);
+    snprintf(text_state.font_name, sizeof(text_state.font_name), "%s", text_font);
+    text_state.font_serial++;
+  }
+  return true;
+}
+
+static PangoLayout *make_pango_layout(const char *text, bool pango_markup, int width) {
+  PangoLayout *layout = pango_layout_new(text_state.context);
+  pango_layout_set_font_description(layout, text_state.font);
 
   if (pango_markup) {
     PangoAttrList *attrs;
@@ -98,100 +195,255 @@ settext_default:
     pango_layout_set_text(layout, text, -1);
   }
 
+  if (width >= 0) {
+    pango_layout_set_width(layout, width * PANGO_SCALE);
+    pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
+  }
+
   return layout;
 }
 
-static void text_calc_size(struct bwm_text_buffer *buffer) {
-  cairo_surface_t *recorder = cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, NULL);
-  cairo_t *c = cairo_create(recorder);
-  cairo_surface_destroy(recorder);
-  if (cairo_status(c) != CAIRO_STATUS_SUCCESS) {
-    cairo_destroy(c);
-    return;
+// shaped layout for text, width -1 leaves it unbounded
+static struct layout_entry *layout_lookup(const char *text, bool pango_markup, int width) {
+  if (!text_state_update())
+    return NULL;
+
+  uint32_t hash = hash_string(text);
+  struct layout_entry *victim = &text_state.layouts[0];
+  for (size_t i = 0; i < LAYOUT_CACHE_SIZE; i++) {
+    struct layout_entry *e = &text_state.layouts[i];
+    if (e->layout && e->hash == hash && e->width == width &&
+        e->pango_markup == pango_markup && strcmp(e->text, text) == 0) {
+      e->last_used = ++text_state.clock;
+      return e;
+    }
+    if (victim->layout && (e->layout == NULL || e->last_used < victim->last_used))
+      victim = e;
   }
 
-  PangoLayout *layout = make_pango_layout(c, buffer->text, buffer->props.pango_markup);
+  char *copy = strdup(text);
+  if (copy == NULL)
+    return NULL;
 
-  int width = 0, height = 0;
-  pango_layout_get_pixel_size(layout, &width, &height);
+  layout_entry_clear(victim);
+  victim->text = copy;
+  victim->hash = hash;
+  victim->pango_markup = pango_markup;
+  victim->width = width;
+  victim->layout = make_pango_layout(text, pango_markup, width);
 
-  PangoLayoutIter *iter = pango_layout_get_iter(layout);
-  buffer->props.baseline = pango_layout_iter_get_baseline(iter) / PANGO_SCALE;
-  pango_layout_iter_free(iter);
+  int w = 0, h = 0;
+  pango_layout_get_pixel_size(victim->layout, &w, &h);
+  victim->pixel_width = w;
 
-  buffer->props.width = width;
-
-  g_object_unref(layout);
-  cairo_destroy(c);
+  PangoLayoutIter *iter = pango_layout_get_iter(victim->layout);
+  victim->baseline = pango_layout_iter_get_baseline(iter) / PANGO_SCALE;
+  pango_layout_iter_free(iter);
 
-  wlr_scene_buffer_set_dest_size(buffer->buffer_node, get_text_width(&buffer->props),
-    buffer->props.height);
+  victim->last_used = ++text_state.clock;
+  return victim;
 }
 
-static void render_backing_buffer(struct bwm_text_buffer *buffer) {
-  if (!buffer->visible)
-    return;
+static bool raster_matches(struct raster_entry *e, uint32_t hash,
+                           const struct bwm_text_buffer *buffer, int width, float scale) {
+  const struct bwm_text_node *props = &buffer->props;
+  return e->buffer && e->hash == hash && e->width == width &&
+    e->height == props->height && e->scale == scale &&
+    e->pango_markup == props->pango_markup &&
+    memcmp(e->color, props->color, sizeof(e->color)) == 0 &&
+    memcmp(e->background, props->background, sizeof(e->background)) == 0 &&
+    strcmp(e->text, buffer->text) == 0;
+}
 
-  if (buffer->props.max_width == 0) {
-    wlr_scene_buffer_set_buffer(buffer->buffer_node, NULL);
-    return;
+static struct wlr_buffer *raster_lookup(const struct bwm_text_buffer *buffer, int width,
+                                        float scale, struct raster_entry **victim_out) {
+  uint32_t hash = hash_string(buffer->text);
+  struct raster_entry *victim = &text_state.rasters[0];
+  for (size_t i = 0; i < RASTER_CACHE_SIZE; i++) {
+    struct raster_entry *e = &text_state.rasters[i];
+    if (raster_matches(e, hash, buffer, width, scale)) {
+      e->last_used = ++text_state.clock;
+      return e->buffer;
+    }
+    if (victim->buffer && (e->buffer == NULL || e->last_used < victim->last_used))
+      victim = e;
   }
+  *victim_out = victim;
+  return NULL;
+}
 
-  float scale = buffer->scale > 0 ? buffer->scale : 1.0f;
-  int width = (int)ceilf(get_text_width(&buffer->props) * scale);
-  int height = (int)ceilf(buffer->props.height * scale);
+static struct wlr_buffer *rasterize(const struct bwm_text_buffer *buffer, int width,
+                                    float scale) {
+  int buf_width = (int)ceilf(width * scale);
+  int buf_height = (int)ceilf(buffer->props.height * scale);
+  if (buf_width <= 0 || buf_height <= 0)
+    return NULL;
 
-  if (width <= 0 || height <= 0) {
-    wlr_scene_buffer_set_buffer(buffer->buffer_node, NULL);
-    return;
-  }
+  struct layout_entry *entry = layout_lookup(buffer->text, buffer->props.pango_markup, width);
+  if (entry == NULL)
+    return NULL;
 
-  cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  cairo_surface_t *surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32,
+    buf_width, buf_height);
   if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
     cairo_surface_destroy(surface);
-    return;
+    return NULL;
   }
 
   struct cairo_buffer *cairo_buffer = calloc(1, sizeof(*cairo_buffer));
   if (!cairo_buffer) {
     cairo_surface_destroy(surface);
-    return;
+    return NULL;
   }
 
   cairo_t *cairo = cairo_create(surface);
   if (!cairo) {
     cairo_surface_destroy(surface);
     free(cairo_buffer);
-    return;
+    return NULL;
   }
 
   cairo_set_antialias(cairo, CAIRO_ANTIALIAS_BEST);
 
-  float *bg = buffer->props.background;
+  const float *bg = buffer->props.background;
   cairo_set_source_rgba(cairo, bg[0], bg[1], bg[2], bg[3]);
-  cairo_rectangle(cairo, 0, 0, width, height);
+  cairo_rectangle(cairo, 0, 0, buf_width, buf_height);
   cairo_fill(cairo);
 
-  float *fg = buffer->props.color;
+  const float *fg = buffer->props.color;
   cairo_set_source_rgba(cairo, fg[0], fg[1], fg[2], fg[3]);
 
-  PangoLayout *layout = make_pango_layout(cairo, buffer->text, buffer->props.pango_markup);
-  pango_layout_set_width(layout, width * PANGO_SCALE);
-  pango_layout_set_ellipsize(layout, PANGO_ELLIPSIZE_END);
-
   cairo_scale(cairo, scale, scale);
   cairo_move_to(cairo, 0, 0);
-  pango_cairo_show_layout(cairo, layout);
-  g_object_unref(layout);
+  pango_cairo_show_layout(cairo, entry->layout);
 
   cairo_surface_flush(surface);
 
-  wlr_buffer_init(&cairo_buffer->base, &cairo_buffer_impl, width, height);
+  wlr_buffer_init(&cairo_buffer->base, &cairo_buffer_impl, buf_width, buf_height);
   cairo_buffer->surface = surface;
   cairo_buffer->cairo = cairo;
+  return &cairo_buffer->base;
+}
+
+static void shades_clear(struct bwm_text_buffer *buffer) {
+  for (size_t i = 0; i < TEXT_SHADES; i++) {
+    if (buffer->shades[i].buffer)
+      wlr_buffer_unlock(buffer->shades[i].buffer);
+    buffer->shades[i].buffer = NULL;
+  }
+}
 
-  wlr_scene_buffer_set_buffer(buffer->buffer_node, &cairo_buffer->base);
-  wlr_buffer_drop(&cairo_buffer->base);
+static struct text_shade *shade_lookup(struct bwm_text_buffer *buffer, int width,
+                                       float scale) {
+  for (size_t i = 0; i < TEXT_SHADES; i++) {
+    struct text_shade *sh = &buffer->shades[i];
+    if (sh->buffer && sh->width == width && sh->height == buffer->props.height &&
+        sh->scale == scale && sh->font_serial == text_state.font_serial &&
+        memcmp(sh->color, buffer->props.color, sizeof(sh->color)) == 0 &&
+        memcmp(sh->background, buffer->props.background, sizeof(sh->background)) == 0) {
+      sh->last_used = ++text_state.clock;
+      return sh;
+    }
+  }
+  return NULL;
+}
+
+static void shade_store(struct bwm_text_buffer *buffer, struct wlr_buffer *wlr_buffer,
+                        int width, float scale) {
+  struct text_shade *sh = &buffer->shades[0];
+  for (size_t i = 1; i < TEXT_SHADES && sh->buffer; i++)
+    if (buffer->shades[i].buffer == NULL || buffer->shades[i].last_used < sh->last_used)
+      sh = &buffer->shades[i];
+
+  if (sh->buffer)
+    wlr_buffer_unlock(sh->buffer);
+  sh->buffer = wlr_buffer_lock(wlr_buffer);
+  memcpy(sh->color, buffer->props.color, sizeof(sh->color));
+  memcpy(sh->background, buffer->props.background, sizeof(sh->background));
+  sh->width = width;
+  sh->height = buffer->props.height;
+  sh->scale = scale;
+  sh->font_serial = text_state.font_serial;
+  sh->last_used = ++text_state.clock;
+}
+
+static void text_calc_size(struct bwm_text_buffer *buffer) {
+  struct layout_entry *entry = layout_lookup(buffer->text, buffer->props.pango_markup, -1);
+  if (entry == NULL)
+    return;
+
+  buffer->props.width = entry->pixel_width;
+  buffer->props.baseline = entry->baseline;
+
+  wlr_scene_buffer_set_dest_size(buffer->buffer_node, get_text_width(&buffer->props),
+    buffer->props.height);
+}
+
+static void render_backing_buffer(struct bwm_text_buffer *buffer) {
+  if (!buffer->visible)
+    return;
+
+  if (buffer->props.max_width == 0) {
+    wlr_scene_buffer_set_buffer(buffer->buffer_node, NULL);
+    return;
+  }
+
+  float scale = buffer->scale > 0 ? buffer->scale : 1.0f;
+  int width = get_text_width(&buffer->props);
+  if (width <= 0 || buffer->props.height <= 0 || !text_state_update()) {
+    wlr_scene_buffer_set_buffer(buffer->buffer_node, NULL);
+    return;
+  }
+
+  // color flips only swap between buffers this node already holds
+  struct text_shade *shade = shade_lookup(buffer, width, scale);
+  if (shade) {
+    wlr_scene_buffer_set_buffer(buffer->buffer_node, shade->buffer);
+    return;
+  }
+
+  struct raster_entry *victim = NULL;
+  struct wlr_buffer *cached = raster_lookup(buffer, width, scale, &victim);
+  if (cached) {
+    shade_store(buffer, cached, width, scale);
+    wlr_scene_buffer_set_buffer(buffer->buffer_node, cached);
+    return;
+  }
+
+  struct wlr_buffer *rendered = rasterize(buffer, width, scale);
+  if (rendered == NULL)
+    return;
+
+  char *copy = strdup(buffer->text);
+  if (copy) {
+    raster_entry_clear(victim);
+    victim->text = copy;
+    victim->hash = hash_string(copy);
+    victim->pango_markup = buffer->props.pango_markup;
+    victim->width = width;
+    victim->height = buffer->props.height;
+    victim->scale = scale;
+    memcpy(victim->color, buffer->props.color, sizeof(victim->color));
+    memcpy(victim->background, buffer->props.background, sizeof(victim->background));
+    victim->buffer = wlr_buffer_lock(rendered);
+    victim->last_used = ++text_state.clock;
+  }
+
+  shade_store(buffer, rendered, width, scale);
+  wlr_scene_buffer_set_buffer(buffer->buffer_node, rendered);
+  wlr_buffer_drop(rendered);
+}
+
+void text_fini(void) {
+  text_cache_flush();
+  if (text_state.font) {
+    pango_font_description_free(text_state.font);
+    text_state.font = NULL;
+  }
+  if (text_state.context) {
+    g_object_unref(text_state.context);
+    text_state.context = NULL;
+  }
 }
 
 static void handle_outputs_update(struct wl_listener *listener, void *data) {
@@ -199,6 +451,9 @@ static void handle_outputs_update(struct wl_listener *listener, void *data) {
       wl_container_of(listener, buffer, outputs_update);
   struct wlr_scene_outputs_update_event *event = data;
 
+  // one buffer serves every output the label is on, so it is drawn for
+  // the densest one. Labels crossing between scales swap to buffers kept
+  // per scale instead of rasterizing again
   float scale = 0;
   for (size_t i = 0; i < event->size; i++) {
     struct wlr_scene_output *o = event->active[i];
@@ -221,6 +476,7 @@ static void handle_destroy(struct wl_listener *listener, void *data) {
   wl_list_remove(&buffer->outputs_update.link);
   wl_list_remove(&buffer->destroy.link);
 
+  shades_clear(buffer);
   free(buffer->text);
   free(buffer);
 }
@@ -299,6 +555,7 @@ void bwm_text_node_set_text(struct bwm_text_node *node, const char *text) {
     return;
   free(buffer->text);
   buffer->text = new_text;
+  shades_clear(buffer);
   text_calc_size(buffer);
   render_backing_buffer(buffer);
 }
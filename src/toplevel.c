@@ -8,15 +8,18 @@
 #include "tabs.h"
 #include "tree.h"
 #include "transaction.h"
+#include "spatial.h"
 #include "types.h"
 #include "rule.h"
 #include "scroller.h"
 #include "xwayland.h"
 #include "input_method.h"
+#include "animation.h"
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
 #include <wayland-server-core.h>
+#include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/types/wlr_xdg_shell.h>
 #include <wlr/types/wlr_xdg_decoration_v1.h>
@@ -133,14 +136,16 @@ static void handle_foreign_fullscreen_request(struct wl_listener *listener, void
 
   if (event->fullscreen) {
     set_state(m, d, toplevel->node, STATE_FULLSCREEN);
-    wlr_scene_node_reparent(&toplevel->scene_tree->node, server.full_tree);
+    wlr_scene_node_reparent(&toplevel->scene_tree->node,
+      desktop_layer(toplevel->node->desktop, server.full_tree));
   } else {
     client_state_t last = toplevel->node->client->last_state;
     if (last == STATE_FLOATING)
       set_state(m, d, toplevel->node, STATE_FLOATING);
     else
       set_state(m, d, toplevel->node, STATE_TILED);
-    wlr_scene_node_reparent(&toplevel->scene_tree->node, server.tile_tree);
+    wlr_scene_node_reparent(&toplevel->scene_tree->node,
+      desktop_layer(toplevel->node->desktop, server.tile_tree));
   }
 
   wlr_xdg_toplevel_set_fullscreen(toplevel->xdg_toplevel, event->fullscreen);
@@ -263,6 +268,7 @@ void toplevel_map(struct wl_listener *listener, void *data) {
 
   // link client and toplevel
   n->client->toplevel = toplevel;
+  n->client->node = n;
   toplevel->node = n;
 
   // set initial app_id and title
@@ -417,7 +423,8 @@ void toplevel_map(struct wl_listener *listener, void *data) {
 
   // center to output if floating, also ensure it does not tile
   if (rule && rule->state == STATE_FLOATING) {
-  	wlr_scene_node_reparent(&toplevel->scene_tree->node, server.float_tree);
+  	wlr_scene_node_reparent(&toplevel->scene_tree->node,
+      desktop_layer(target_desktop, server.float_tree));
     struct wlr_box mon_rect = target_output->rectangle;
     struct wlr_box base_rect = n->client->toplevel->xdg_toplevel->base->geometry;
    	n->client->floating_rectangle = (struct wlr_box){
@@ -462,12 +469,8 @@ void toplevel_map(struct wl_listener *listener, void *data) {
     wlr_surface_set_preferred_buffer_scale(toplevel->xdg_toplevel->base->surface, ceil(scale));
   }
 
-  // hide window if target desktop is not the focused desktop
+  // a hidden target desktop keeps the window hidden through its scene layer
   bool target_desktop_is_focused = (target_desktop == (target_output ? target_output->desk : NULL));
-  if (desktop_changed && !target_desktop_is_focused) {
-    n->client->shown = false;
-    wlr_scene_node_set_enabled(&toplevel->scene_tree->node, false);
-  }
 
   if (should_focus && target_desktop_is_focused && target_output)
   	focus_node(target_output, target_desktop, n);
@@ -501,6 +504,8 @@ void toplevel_freeze_sibling_buffers(desktop_t *d, node_t *n) {
   node_t *root = d->root;
   node_t *leaf = first_extrema(root);
   while (leaf) {
+    if (leaf != n)
+      animation_finish(leaf);
     if (leaf != n
         && leaf->client
         && leaf->client->shown
@@ -537,11 +542,14 @@ void toplevel_unmap(struct wl_listener *listener, void *data) {
   if (toplevel->node == NULL)
     return;
 
-  if (toplevel->node->client && toplevel->node->client->shown)
-    toplevel_save_buffer(toplevel);
-
   node_t *n = toplevel->node;
 
+  if (n->client && n->client->shown) {
+    animation_finish(n);
+    toplevel_save_buffer(toplevel);
+    animation_close(n, toplevel->saved_surface_tree);
+  }
+
   struct bwm_output *m = mon;
   desktop_t *d = NULL;
 
@@ -859,6 +867,7 @@ void toplevel_destroy(struct wl_listener *listener, void *data) {
   destroy_borders(&toplevel->border_tree, toplevel->border_rects);
 
   toplevel->saved_surface_tree = NULL;
+  toplevel->snapshot_tree = NULL;
 
   wl_list_remove(&toplevel->map.link);
   wl_list_remove(&toplevel->unmap.link);
@@ -941,14 +950,16 @@ void toplevel_request_fullscreen(struct wl_listener *listener, void *data) {
 
   if (requested_fullscreen) {
     set_state(m, d, toplevel->node, STATE_FULLSCREEN);
-    wlr_scene_node_reparent(&toplevel->scene_tree->node, server.full_tree);
+    wlr_scene_node_reparent(&toplevel->scene_tree->node,
+      desktop_layer(toplevel->node->desktop, server.full_tree));
   } else {
     client_state_t last = toplevel->node->client->last_state;
     if (last == STATE_FLOATING)
       set_state(m, d, toplevel->node, STATE_FLOATING);
     else
       set_state(m, d, toplevel->node, STATE_TILED);
-    wlr_scene_node_reparent(&toplevel->scene_tree->node, server.tile_tree);
+    wlr_scene_node_reparent(&toplevel->scene_tree->node,
+      desktop_layer(toplevel->node->desktop, server.tile_tree));
   }
 
   wlr_xdg_toplevel_set_fullscreen(toplevel->xdg_toplevel, requested_fullscreen);
@@ -969,13 +980,8 @@ void toplevel_set_title(struct wl_listener *listener, void *data) {
       wlr_log(WLR_DEBUG, "Toplevel title changed: %s", title);
     }
 
-    if (toplevel->foreign_toplevel && title)
-      wlr_foreign_toplevel_handle_v1_set_title(toplevel->foreign_toplevel, title);
-
-    if (toplevel->ext_foreign_toplevel)
-      update_ext_foreign_toplevel(toplevel);
-
-    tabs_update_label_for_leaf(toplevel->node);
+    toplevel->title_dirty = true;
+    toplevel_schedule_names(toplevel->node);
   }
 }
 
@@ -991,14 +997,47 @@ void toplevel_set_app_id(struct wl_listener *listener, void *data) {
       wlr_log(WLR_DEBUG, "Toplevel app_id changed: %s", app_id);
     }
 
-    if (toplevel->foreign_toplevel && app_id)
+    toplevel->app_id_dirty = true;
+    toplevel_schedule_names(toplevel->node);
+  }
+}
+
+static bool names_pending = false;
+
+void toplevel_schedule_names(node_t *n) {
+  names_pending = true;
+
+  struct bwm_output *output = n && n->output ? n->output : server.focused_output;
+  if (output && output->wlr_output)
+    wlr_output_schedule_frame(output->wlr_output);
+}
+
+void toplevel_flush_names(void) {
+  if (!names_pending)
+    return;
+  names_pending = false;
+
+  struct bwm_toplevel *toplevel;
+  wl_list_for_each(toplevel, &server.toplevels, link) {
+    if (!toplevel->title_dirty && !toplevel->app_id_dirty)
+      continue;
+
+    const char *title = toplevel->xdg_toplevel->title;
+    const char *app_id = toplevel->xdg_toplevel->app_id;
+    if (toplevel->foreign_toplevel && toplevel->title_dirty && title)
+      wlr_foreign_toplevel_handle_v1_set_title(toplevel->foreign_toplevel, title);
+    if (toplevel->foreign_toplevel && toplevel->app_id_dirty && app_id)
       wlr_foreign_toplevel_handle_v1_set_app_id(toplevel->foreign_toplevel, app_id);
 
     if (toplevel->ext_foreign_toplevel)
       update_ext_foreign_toplevel(toplevel);
 
     tabs_update_label_for_leaf(toplevel->node);
+    toplevel->title_dirty = false;
+    toplevel->app_id_dirty = false;
   }
+
+  xwayland_flush_names();
 }
 
 void focus_toplevel(struct bwm_toplevel *toplevel) {
@@ -1024,6 +1063,7 @@ void focus_toplevel(struct bwm_toplevel *toplevel) {
   }
 
   wlr_scene_node_raise_to_top(&toplevel->scene_tree->node);
+  spatial_invalidate();
 
   wlr_xdg_toplevel_set_activated(toplevel->xdg_toplevel, true);
 
@@ -1047,19 +1087,7 @@ void focus_toplevel(struct bwm_toplevel *toplevel) {
   if (toplevel->node) {
     struct bwm_output *m = toplevel->node->output;
     desktop_t *d = m ? m->desk : NULL;
-    if (d && d->root != NULL) {
-      for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root)) {
-        if (node->client == NULL)
-          continue;
-        if (node->client->toplevel) {
-          update_border_colors(node->client->toplevel->border_tree,
-                              node->client->toplevel->border_rects, node->client);
-        } else if (node->client->xwayland_view) {
-          update_border_colors(node->client->xwayland_view->border_tree,
-                              node->client->xwayland_view->border_rects, node->client);
-        }
-      }
-    }
+    update_focus_borders(d);
   }
 }
 
@@ -1195,9 +1223,15 @@ bool toplevel_is_ready(struct bwm_toplevel *toplevel) {
 
 static int buffer_copy_count = 0;
 
+struct save_buffer_ctx {
+  struct wlr_scene_tree *tree;
+  struct wl_list *next;  // next reusable child in tree
+  int saved;
+};
+
 static void save_buffer_iterator(struct wlr_scene_buffer *buffer,
                                  int sx, int sy, void *data) {
-  struct wlr_scene_tree *tree = data;
+  struct save_buffer_ctx *ctx = data;
 
   buffer_copy_count++;
   wlr_log(WLR_DEBUG, "save_buffer_iterator called: buffer=%p, sx=%d, sy=%d",
@@ -1209,10 +1243,19 @@ static void save_buffer_iterator(struct wlr_scene_buffer *buffer,
     return;
   }
 
-  struct wlr_scene_buffer *sbuf = wlr_scene_buffer_create(tree, NULL);
-  if (!sbuf) {
-    wlr_log(WLR_ERROR, "Could not allocate a scene buffer when saving a surface");
-    return;
+  // reuse a buffer node from a previous snapshot if there is one
+  struct wlr_scene_buffer *sbuf;
+  if (ctx->next != &ctx->tree->children) {
+    struct wlr_scene_node *node = wl_container_of(ctx->next, node, link);
+    ctx->next = ctx->next->next;
+    sbuf = wlr_scene_buffer_from_node(node);
+    wlr_scene_node_set_enabled(&sbuf->node, true);
+  } else {
+    sbuf = wlr_scene_buffer_create(ctx->tree, NULL);
+    if (!sbuf) {
+      wlr_log(WLR_ERROR, "Could not allocate a scene buffer when saving a surface");
+      return;
+    }
   }
 
   wlr_scene_buffer_set_dest_size(sbuf, buffer->dst_width, buffer->dst_height);
@@ -1221,49 +1264,67 @@ static void save_buffer_iterator(struct wlr_scene_buffer *buffer,
   wlr_scene_node_set_position(&sbuf->node, sx, sy);
   wlr_scene_buffer_set_transform(sbuf, buffer->transform);
   wlr_scene_buffer_set_buffer(sbuf, buffer->buffer);
+  ctx->saved++;
 
   wlr_log(WLR_DEBUG, "Successfully copied buffer %dx%d at (%d,%d)",
           buffer->dst_width, buffer->dst_height, sx, sy);
 }
 
+// drop buffer references held by snapshot nodes from start onwards
+static void release_snapshot_buffers(struct wlr_scene_tree *tree,
+                                     struct wl_list *start) {
+  for (struct wl_list *l = start; l != &tree->children; l = l->next) {
+    struct wlr_scene_node *node = wl_container_of(l, node, link);
+    struct wlr_scene_buffer *sbuf = wlr_scene_buffer_from_node(node);
+    wlr_scene_node_set_enabled(&sbuf->node, false);
+    wlr_scene_buffer_set_buffer(sbuf, NULL);
+  }
+}
+
 void toplevel_save_buffer(struct bwm_toplevel *toplevel) {
   if (!toplevel || !toplevel->scene_tree || !toplevel->content_tree)
     return;
 
-  // removed saved buffer
-  if (toplevel->saved_surface_tree) {
-    wlr_log(WLR_DEBUG, "Removing existing saved buffer before saving new one");
-    toplevel_remove_saved_buffer(toplevel);
-  }
-
-  toplevel->saved_surface_tree = wlr_scene_tree_create(toplevel->scene_tree);
-  if (!toplevel->saved_surface_tree) {
-    wlr_log(WLR_ERROR, "Could not allocate a scene tree node when saving a surface");
+  // content_tree is disabled while a snapshot is shown, copying it again
+  // would find no buffers and tear the visible snapshot down
+  if (toplevel->saved_surface_tree)
     return;
+
+  if (!toplevel->snapshot_tree) {
+    toplevel->snapshot_tree = wlr_scene_tree_create(toplevel->scene_tree);
+    if (!toplevel->snapshot_tree) {
+      wlr_log(WLR_ERROR, "Could not allocate a scene tree node when saving a surface");
+      return;
+    }
+    wlr_scene_node_set_enabled(&toplevel->snapshot_tree->node, false);
   }
 
-  wlr_scene_node_set_enabled(&toplevel->saved_surface_tree->node, false);
+  // copy scene buffers over the previous snapshot
+  struct save_buffer_ctx ctx = {
+    .tree = toplevel->snapshot_tree,
+    .next = toplevel->snapshot_tree->children.next,
+  };
 
-  // copy scene buffers
   buffer_copy_count = 0;
   wlr_log(WLR_DEBUG, "Starting buffer iteration for content_tree=%p",
           (void*)toplevel->content_tree);
 
   wlr_scene_node_for_each_buffer(&toplevel->content_tree->node,
-                                 save_buffer_iterator,
-                                 toplevel->saved_surface_tree);
+                                 save_buffer_iterator, &ctx);
 
   wlr_log(WLR_DEBUG, "Buffer iteration complete, copied %d buffers", buffer_copy_count);
 
-  bool has_children = !wl_list_empty(&toplevel->saved_surface_tree->children);
+  bool has_children = ctx.saved > 0;
+  release_snapshot_buffers(toplevel->snapshot_tree, ctx.next);
+
   wlr_log(WLR_DEBUG, "After iteration: saved_surface_tree has_children=%d", has_children);
 
   if (!has_children) {
-    // cleanup
-    wlr_scene_node_destroy(&toplevel->saved_surface_tree->node);
-    toplevel->saved_surface_tree = NULL;
-    wlr_log(WLR_DEBUG, "No buffers to save for toplevel - destroyed saved tree");
+    toplevel_remove_saved_buffer(toplevel);
+    wlr_log(WLR_DEBUG, "No buffers to save for toplevel");
   } else {
+    toplevel->saved_surface_tree = toplevel->snapshot_tree;
+    wlr_scene_node_raise_to_top(&toplevel->saved_surface_tree->node);
     wlr_scene_node_set_enabled(&toplevel->content_tree->node, false);
     wlr_scene_node_set_enabled(&toplevel->saved_surface_tree->node, true);
     wlr_log(WLR_DEBUG, "Saved buffer for toplevel - swapped content_tree for saved_surface_tree");
@@ -1276,7 +1337,10 @@ void toplevel_remove_saved_buffer(struct bwm_toplevel *toplevel) {
 
   wlr_log(WLR_DEBUG, "Removing saved buffer for toplevel");
 
-  wlr_scene_node_destroy(&toplevel->saved_surface_tree->node);
+  // keep the tree and its nodes around for the next snapshot
+  wlr_scene_node_set_enabled(&toplevel->saved_surface_tree->node, false);
+  release_snapshot_buffers(toplevel->saved_surface_tree,
+                           toplevel->saved_surface_tree->children.next);
   toplevel->saved_surface_tree = NULL;
 
   if (toplevel->content_tree)
@@ -4,6 +4,11 @@
 #include "tree.h"
 #include "types.h"
 #include "output.h"
+#include "spatial.h"
+#include "animation.h"
+#include "scroller.h"
+#include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <wlr/types/wlr_xdg_shell.h>
@@ -14,6 +19,12 @@
 // timeout in milliseconds
 #define TXN_TIMEOUT_MS 200
 
+// stats sizes
+#define TXN_STATS_RING 16
+#define TXN_STATS_CLIENTS 32
+
+bool transaction_partial_apply = false;
+
 // transaction state
 static struct {
   struct bwm_transaction *pending_transaction;
@@ -23,6 +34,15 @@ static struct {
   size_t dirty_capacity;
 } txn_state = {0};
 
+// latency stats
+static struct {
+  struct bwm_transaction_record records[TXN_STATS_RING];
+  size_t record_head;
+  size_t record_count;
+  struct bwm_client_latency clients[TXN_STATS_CLIENTS];
+  size_t client_count;
+} txn_stats = {0};
+
 static void transaction_commit(struct bwm_transaction *txn);
 static void _transaction_commit_dirty(bool server_request);
 
@@ -72,6 +92,106 @@ static void transaction_destroy(struct bwm_transaction *txn) {
   free(txn);
 }
 
+static double ms_since(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1000.0 +
+         (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static struct bwm_client_latency *client_latency_get(const char *app_id) {
+  if (!app_id || !app_id[0])
+    return NULL;
+
+  for (size_t i = 0; i < txn_stats.client_count; i++)
+    if (strncmp(txn_stats.clients[i].app_id, app_id, TXN_APP_ID_LEN - 1) == 0)
+      return &txn_stats.clients[i];
+
+  // evict the entry with the fewest samples when full
+  struct bwm_client_latency *entry;
+  if (txn_stats.client_count < TXN_STATS_CLIENTS) {
+    entry = &txn_stats.clients[txn_stats.client_count++];
+  } else {
+    entry = &txn_stats.clients[0];
+    for (size_t i = 1; i < TXN_STATS_CLIENTS; i++)
+      if (txn_stats.clients[i].samples < entry->samples)
+        entry = &txn_stats.clients[i];
+  }
+
+  memset(entry, 0, sizeof(*entry));
+  snprintf(entry->app_id, sizeof(entry->app_id), "%s", app_id);
+  return entry;
+}
+
+static void stats_add_ack(struct bwm_transaction *txn, const char *app_id,
+                          double ms, bool timed_out) {
+  struct bwm_client_ack *ack;
+  if (txn->num_acks < TXN_RECORD_CLIENTS) {
+    ack = &txn->acks[txn->num_acks++];
+  } else {
+    // full, keep timeouts and the slowest acks
+    ack = NULL;
+    for (size_t i = 0; i < TXN_RECORD_CLIENTS; i++) {
+      struct bwm_client_ack *a = &txn->acks[i];
+      if (!a->timed_out && (!ack || a->ms < ack->ms))
+        ack = a;
+    }
+    if (!ack || (!timed_out && ms <= ack->ms))
+      return;
+  }
+
+  snprintf(ack->app_id, sizeof(ack->app_id), "%s", app_id ? app_id : "");
+  ack->ms = ms;
+  ack->timed_out = timed_out;
+}
+
+static void stats_client_ready(struct bwm_transaction_inst *instruction) {
+  node_t *node = instruction->node;
+  if (!node || !node->client)
+    return;
+
+  struct bwm_transaction *txn = instruction->transaction;
+  double ms = ms_since(&txn->commit_time);
+  stats_add_ack(txn, node->client->app_id, ms, false);
+
+  struct bwm_client_latency *entry = client_latency_get(node->client->app_id);
+  if (!entry)
+    return;
+  entry->samples++;
+  entry->total_ms += ms;
+  if (ms > entry->max_ms)
+    entry->max_ms = ms;
+}
+
+static void stats_client_timeout(struct bwm_transaction_inst *instruction) {
+  node_t *node = instruction->node;
+  if (!node || !node->client)
+    return;
+
+  struct bwm_transaction *txn = instruction->transaction;
+  txn->num_timeouts++;
+  stats_add_ack(txn, node->client->app_id, ms_since(&txn->commit_time), true);
+
+  struct bwm_client_latency *entry = client_latency_get(node->client->app_id);
+  if (entry)
+    entry->timeouts++;
+}
+
+static void stats_record(struct bwm_transaction *txn) {
+  struct bwm_transaction_record *rec = &txn_stats.records[txn_stats.record_head];
+  rec->commit_time = txn->commit_time;
+  rec->duration_ms = ms_since(&txn->commit_time);
+  rec->num_instructions = (size_t)wl_list_length(&txn->instructions);
+  rec->num_configures = txn->num_configures;
+  rec->num_timeouts = txn->num_timeouts;
+  memcpy(rec->acks, txn->acks, sizeof(rec->acks));
+  rec->num_acks = txn->num_acks;
+
+  txn_stats.record_head = (txn_stats.record_head + 1) % TXN_STATS_RING;
+  if (txn_stats.record_count < TXN_STATS_RING)
+    txn_stats.record_count++;
+}
+
 static void copy_node_state(node_t *node,
                            struct bwm_transaction_inst *instruction) {
   if (!node || !instruction)
@@ -211,11 +331,6 @@ static void apply_node_state(node_t *node,
       return;
     }
 
-    if (node->client->toplevel && node->client->toplevel->saved_surface_tree) {
-      toplevel_remove_saved_buffer(node->client->toplevel);
-      wlr_log(WLR_DEBUG, "Removed saved buffer for node %u", node->id);
-    }
-
     wlr_log(WLR_DEBUG, "Applying geometry to node %u: pos=(%d,%d) size=(%dx%d) serial=%u",
             node->id, rect->x, rect->y, rect->width, rect->height, instruction->serial);
 
@@ -290,6 +405,17 @@ static void apply_node_state(node_t *node,
       wlr_log(WLR_DEBUG, "Applied layout to node %u [waiting to be shown] configured=%d shown=%d",
           node->id, configured, node->client->shown);
     }
+
+    // animate from the last placed geometry, a resized toplevel keeps its
+    // saved buffer stretched in place of the client until the end
+    struct wlr_box from = node->client->applied_rectangle;
+    node->client->applied_rectangle = *rect;
+    bool stretched = animation_move(node, from, *rect);
+
+    if (!stretched && node->client->toplevel && node->client->toplevel->saved_surface_tree) {
+      toplevel_remove_saved_buffer(node->client->toplevel);
+      wlr_log(WLR_DEBUG, "Removed saved buffer for node %u", node->id);
+    }
   }
 }
 
@@ -309,11 +435,7 @@ static void transaction_apply(struct bwm_transaction *txn) {
     return;
   }
 
-  struct timespec now;
-  clock_gettime(CLOCK_MONOTONIC, &now);
-
-  double ms = (now.tv_sec - txn->commit_time.tv_sec) * 1000.0 +
-              (now.tv_nsec - txn->commit_time.tv_nsec) / 1000000.0;
+  double ms = ms_since(&txn->commit_time);
 
   wlr_log(WLR_INFO, "Transaction applying after %.1fms (%zu waiting, %zu total",
           ms, txn->num_waiting, (size_t)wl_list_length(&txn->instructions));
@@ -325,6 +447,12 @@ static void transaction_apply(struct bwm_transaction *txn) {
       continue;
     }
 
+    if (instruction->applied) {
+      wlr_log(WLR_DEBUG, "Skipping apply for node %u — already applied early",
+              instruction->node->id);
+      continue;
+    }
+
     if (txn_state.pending_transaction &&
         node_in_transaction(txn_state.pending_transaction, instruction->node)) {
       wlr_log(WLR_DEBUG, "Skipping apply for node %u — handled by pending transaction",
@@ -336,6 +464,73 @@ static void transaction_apply(struct bwm_transaction *txn) {
             instruction->node->id, (size_t)instruction->node->ntxnrefs, instruction->node->destroying);
     apply_node_state(instruction->node, instruction);
   }
+
+  // the new column positions are on screen now, slide the strip over
+  wl_list_for_each(instruction, &txn->instructions, link)
+    if (instruction->node && !instruction->node->destroying)
+      scroller_apply_scroll(instruction->node->desktop);
+
+  spatial_invalidate();
+}
+
+static struct wlr_box instruction_target_rect(struct bwm_transaction_inst *instruction) {
+  node_t *node = instruction->node;
+  if (!node->client)
+    return instruction->rectangle;
+  if (instruction->state == STATE_FULLSCREEN && node->output)
+    return node->output->rectangle;
+  if (instruction->state == STATE_FLOATING)
+    return instruction->floating_rectangle;
+  return instruction->tiled_rectangle;
+}
+
+static bool overlaps_waiting(struct bwm_transaction *txn,
+                             struct bwm_transaction_inst *instruction) {
+  struct wlr_box target = instruction_target_rect(instruction);
+  struct wlr_box tmp;
+
+  struct bwm_transaction_inst *other;
+  wl_list_for_each(other, &txn->instructions, link) {
+    if (!other->waiting || other == instruction)
+      continue;
+
+    struct wlr_box new_rect = instruction_target_rect(other);
+    if (wlr_box_intersection(&tmp, &target, &new_rect))
+      return true;
+    // laggards keep showing their saved buffer where they were last placed,
+    // whichever state that was in
+    if (other->node->client &&
+        wlr_box_intersection(&tmp, &target, &other->node->client->applied_rectangle))
+      return true;
+  }
+
+  return false;
+}
+
+// apply ready instructions that cannot visibly collide with a laggard
+static void transaction_apply_ready(struct bwm_transaction *txn) {
+  if (!txn || txn->num_waiting == 0)
+    return;
+
+  struct bwm_transaction_inst *instruction;
+  wl_list_for_each(instruction, &txn->instructions, link) {
+    if (instruction->waiting || instruction->applied || !instruction->node)
+      continue;
+    if (!instruction->node->client || instruction->node->destroying)
+      continue;
+    if (txn_state.pending_transaction &&
+        node_in_transaction(txn_state.pending_transaction, instruction->node))
+      continue;
+    if (overlaps_waiting(txn, instruction))
+      continue;
+
+    wlr_log(WLR_DEBUG, "Partially applying node %u (%zu still waiting)",
+            instruction->node->id, txn->num_waiting);
+    apply_node_state(instruction->node, instruction);
+    instruction->applied = true;
+  }
+
+  spatial_invalidate();
 }
 
 static bool should_configure(node_t *node,
@@ -400,6 +595,7 @@ static int handle_timeout(void *data) {
   wl_list_for_each(inst, &txn->instructions, link) {
     if (!inst->waiting || !inst->node->client || !inst->node->client->toplevel)
       continue;
+    stats_client_timeout(inst);
     wlr_log(WLR_DEBUG, "Unresponsive node %u — keeping last_configured_size (%dx%d)",
             inst->node->id,
             inst->node->client->toplevel->last_configured_size.width,
@@ -413,6 +609,7 @@ static int handle_timeout(void *data) {
   }
 
   transaction_apply(txn);
+  stats_record(txn);
 
   if (txn == txn_state.queued_transaction)
     txn_state.queued_transaction = NULL;
@@ -437,17 +634,22 @@ static void transaction_progress(void) {
   if (!txn_state.queued_transaction)
     return;
 
-  if (txn_state.queued_transaction->num_waiting == 0) {
-    transaction_apply(txn_state.queued_transaction);
-    transaction_destroy(txn_state.queued_transaction);
-    txn_state.queued_transaction = NULL;
+  if (txn_state.queued_transaction->num_waiting > 0) {
+    if (transaction_partial_apply)
+      transaction_apply_ready(txn_state.queued_transaction);
+    return;
+  }
 
-    // promote built-up commit to immediate
-    if (txn_state.pending_transaction) {
-      struct bwm_transaction *txn = txn_state.pending_transaction;
-      txn_state.pending_transaction = NULL;
-      transaction_commit(txn);
-    }
+  transaction_apply(txn_state.queued_transaction);
+  stats_record(txn_state.queued_transaction);
+  transaction_destroy(txn_state.queued_transaction);
+  txn_state.queued_transaction = NULL;
+
+  // promote built-up commit to immediate
+  if (txn_state.pending_transaction) {
+    struct bwm_transaction *txn = txn_state.pending_transaction;
+    txn_state.pending_transaction = NULL;
+    transaction_commit(txn);
   }
 }
 
@@ -499,6 +701,8 @@ static void transaction_commit(struct bwm_transaction *txn) {
         // wait for all mapped toplevels to respond
         instruction->waiting = true;
         txn->num_waiting++;
+        // a stretched saved buffer is still on screen, settle it first
+        animation_finish(node);
         if (has_stable_frame && node->client->shown &&
             !node->client->toplevel->saved_surface_tree &&
             node->client->toplevel->configured) {
@@ -533,6 +737,7 @@ static void transaction_commit(struct bwm_transaction *txn) {
     // no clients
     wlr_log(WLR_DEBUG, "Transaction applying immediately (no configures needed)");
     transaction_apply(txn);
+    stats_record(txn);
     transaction_destroy(txn);
   } else {
     // wait for timeout
@@ -544,6 +749,10 @@ static void transaction_commit(struct bwm_transaction *txn) {
       wl_event_source_timer_update(txn->timer, TXN_TIMEOUT_MS);
 
     txn_state.queued_transaction = txn;
+
+    // instructions that needed no configure can go out right away
+    if (transaction_partial_apply)
+      transaction_apply_ready(txn);
   }
 }
 
@@ -625,6 +834,7 @@ bool transaction_notify_view_ready_by_serial(struct bwm_toplevel *toplevel,
   if (instruction->serial == serial && instruction->waiting) {
     wlr_log(WLR_DEBUG, "View ready by serial %u for node %u",
             serial, node->id);
+    stats_client_ready(instruction);
     set_instruction_ready(instruction);
     return true;
   }
@@ -661,6 +871,7 @@ bool transaction_notify_view_ready_by_geometry(struct bwm_toplevel *toplevel,
 
     wlr_log(WLR_DEBUG, "View ready by geometry (%d,%d %dx%d) for node %u",
             x, y, width, height, node->id);
+    stats_client_ready(instruction);
     set_instruction_ready(instruction);
     return true;
   }
@@ -718,3 +929,88 @@ void transaction_add_dirty_node(node_t *node) {
   wlr_log(WLR_DEBUG, "transaction_add_dirty_node: node %u (total=%zu)",
           node->id, txn_state.dirty_count);
 }
+
+static void stats_append(char *buf, size_t size, size_t *offset,
+                         const char *fmt, ...) {
+  if (*offset + 1 >= size)
+    return;
+
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(buf + *offset, size - *offset, fmt, args);
+  va_end(args);
+
+  if (n < 0)
+    return;
+  *offset += (size_t)n < size - *offset ? (size_t)n : size - *offset - 1;
+}
+
+// append entry only if the closing text still fits after it
+static bool stats_append_entry(char *buf, size_t size, size_t *offset,
+                               size_t reserve, const char *entry) {
+  size_t len = strlen(entry);
+  if (*offset + len + reserve >= size)
+    return false;
+  memcpy(buf + *offset, entry, len + 1);
+  *offset += len;
+  return true;
+}
+
+size_t transaction_stats_format(char *buf, size_t size) {
+  // the reply is capped at size and must stay valid json, so entries are
+  // only added while the rest of the document still fits. per-app_id
+  // stats come first, then as many records as fit, newest first
+  static const char mid[] = "\n  ],\n  \"transactions\": [";
+  static const char tail[] = "\n  ]\n}\n";
+  char entry[1024];
+  size_t offset = 0;
+
+  if (size < sizeof("{\n  \"clients\": [") + sizeof(mid) + sizeof(tail)) {
+    if (size)
+      buf[0] = '\0';
+    return 0;
+  }
+
+  stats_append(buf, size, &offset, "{\n  \"clients\": [");
+
+  for (size_t i = 0; i < txn_stats.client_count; i++) {
+    struct bwm_client_latency *entry_stats = &txn_stats.clients[i];
+    snprintf(entry, sizeof(entry), "%s\n    {\"app_id\": \"%s\", \"samples\": %zu, "
+             "\"avg_ms\": %.1f, \"max_ms\": %.1f, \"timeouts\": %zu}",
+             i ? "," : "",
+             entry_stats->app_id, entry_stats->samples,
+             entry_stats->samples ? entry_stats->total_ms / entry_stats->samples : 0.0,
+             entry_stats->max_ms, entry_stats->timeouts);
+    if (!stats_append_entry(buf, size, &offset, sizeof(mid) + sizeof(tail), entry))
+      break;
+  }
+
+  stats_append_entry(buf, size, &offset, sizeof(tail), mid);
+
+  for (size_t i = 0; i < txn_stats.record_count; i++) {
+    size_t idx = (txn_stats.record_head + TXN_STATS_RING - 1 - i) % TXN_STATS_RING;
+    struct bwm_transaction_record *rec = &txn_stats.records[idx];
+    size_t len = 0;
+    stats_append(entry, sizeof(entry), &len, "%s\n    {\"instructions\": %zu, "
+                 "\"configures\": %zu, \"duration_ms\": %.1f, \"timeouts\": %zu, "
+                 "\"acks\": [",
+                 i ? "," : "", rec->num_instructions, rec->num_configures,
+                 rec->duration_ms, rec->num_timeouts);
+    for (size_t j = 0; j < rec->num_acks; j++) {
+      struct bwm_client_ack *ack = &rec->acks[j];
+      stats_append(entry, sizeof(entry), &len, "%s{\"app_id\": \"%s\", \"ms\": %.1f, "
+                   "\"timed_out\": %s}",
+                   j ? ", " : "", ack->app_id, ack->ms,
+                   ack->timed_out ? "true" : "false");
+    }
+    stats_append(entry, sizeof(entry), &len, "]}");
+    // older records are dropped once the buffer is full
+    if (len + 1 >= sizeof(entry) ||
+        !stats_append_entry(buf, size, &offset, sizeof(tail), entry))
+      break;
+  }
+
+  stats_append_entry(buf, size, &offset, 0, tail);
+
+  return offset;
+}
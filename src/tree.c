@@ -7,6 +7,9 @@
 #include "output.h"
 #include "scroller.h"
 #include "xwayland.h"
+#include "spatial.h"
+#include "hash.h"
+#include "animation.h"
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -43,6 +46,10 @@ char normal_border_color[16] = "444444ff";
 char active_border_color[16] = "555555ff";
 char focused_border_color[16] = "1793dfff";
 char presel_feedback_color[16] = "ff5555ff";
+float normal_border_rgba[4] = {0x44 / 255.0f, 0x44 / 255.0f, 0x44 / 255.0f, 1.0f};
+float active_border_rgba[4] = {0x55 / 255.0f, 0x55 / 255.0f, 0x55 / 255.0f, 1.0f};
+float focused_border_rgba[4] = {0x17 / 255.0f, 0x93 / 255.0f, 0xdf / 255.0f, 1.0f};
+float presel_feedback_rgba[4] = {0xff / 255.0f, 0x55 / 255.0f, 0x55 / 255.0f, 1.0f};
 
 // global state
 struct bwm_output *mon = NULL;
@@ -52,12 +59,18 @@ uint32_t next_node_id = 1;
 uint32_t next_desktop_id = 1;
 uint32_t next_monitor_id = 1;
 
+// resolvers for ipc selectors and rules, kept in sync on create, rename
+// and free
+static struct bwm_hash node_ids;
+static struct bwm_hash desktop_names;
+
 node_t *make_node(uint32_t id) {
   node_t *n = (node_t *)calloc(1, sizeof(node_t));
   if (n == NULL)
     return NULL;
 
   n->id = id != 0 ? id : next_node_id++;
+  hash_insert_id(&node_ids, n->id, n);
   n->split_type = TYPE_VERTICAL;
   n->split_ratio = 0.5;
   n->vacant = false;
@@ -114,6 +127,81 @@ client_t *make_client(void) {
   return c;
 }
 
+desktop_t *make_desktop(const char *name) {
+  desktop_t *d = (desktop_t *)calloc(1, sizeof(desktop_t));
+  if (d == NULL)
+    return NULL;
+
+  d->id = next_desktop_id++;
+  strncpy(d->name, name, SMALEN - 1);
+  d->name[SMALEN - 1] = '\0';
+  d->layout = LAYOUT_TILED;
+  d->user_layout = LAYOUT_TILED;
+  d->window_gap = window_gap;
+  d->border_width = border_width;
+  d->padding = (padding_t){0};
+  desktop_index(d);
+
+  return d;
+}
+
+void free_desktop(desktop_t *d) {
+  if (d == NULL)
+    return;
+
+  desktop_unindex(d);
+  desktop_destroy_layers(d);
+  free(d->columns);
+  free(d);
+}
+
+void desktop_rename(desktop_t *d, const char *name) {
+  hash_remove_name(&desktop_names, d->name, d);
+  strncpy(d->name, name, SMALEN - 1);
+  d->name[SMALEN - 1] = '\0';
+  hash_insert_name(&desktop_names, d->name, d);
+}
+
+void desktop_index(desktop_t *d) {
+  hash_insert_name(&desktop_names, d->name, d);
+}
+
+void desktop_unindex(desktop_t *d) {
+  hash_remove_name(&desktop_names, d->name, d);
+}
+
+// shared names are rare, the lists decide which one comes first
+static desktop_t *desktop_first_named(struct bwm_output *m, const char *name) {
+  for (struct bwm_output *o = m ? m : mon_head; o != NULL; o = m ? NULL : o->next)
+    for (desktop_t *d = o->desk_head; d != NULL; d = d->next)
+      if (strcmp(d->name, name) == 0)
+        return d;
+  return NULL;
+}
+
+desktop_t *desktop_from_name(struct bwm_output *m, const char *name) {
+  desktop_t *found = NULL;
+  for (struct bwm_hash_entry *e = hash_next_name(&desktop_names, name, NULL);
+       e != NULL; e = hash_next_name(&desktop_names, name, e)) {
+    desktop_t *d = e->value;
+    if (m != NULL && d->output != m)
+      continue;
+    if (found != NULL)
+      return desktop_first_named(m, name);
+    found = d;
+  }
+  return found;
+}
+
+node_t *node_from_id(uint32_t id) {
+  return hash_lookup_id(&node_ids, id);
+}
+
+void tree_fini(void) {
+  hash_fini(&node_ids);
+  hash_fini(&desktop_names);
+}
+
 void free_node(node_t *n) {
   if (n == NULL)
     return;
@@ -128,6 +216,15 @@ void free_node(node_t *n) {
   if (n->tab_bar != NULL)
     tabs_destroy(n);
 
+  spatial_invalidate();
+  animation_cancel(n);
+  hash_remove_id(&node_ids, n->id, n);
+
+  for (struct bwm_output *m = mon_head; m != NULL; m = m->next)
+    for (desktop_t *d = m->desk_head; d != NULL; d = d->next)
+      if (d->border_focus == n)
+        d->border_focus = NULL;
+
   if (n->client != NULL) {
     free(n->client);
     n->client = NULL;
@@ -166,9 +263,17 @@ bool is_second_child(node_t *n) {
 unsigned int clients_count_in(node_t *n) {
   if (n == NULL)
     return 0;
-  if (is_leaf(n))
-    return n->client != NULL ? 1 : 0;
-  return clients_count_in(n->first_child) + clients_count_in(n->second_child);
+  return n->clients;
+}
+
+// recompute cached client counts from n up to the root
+void update_clients_count(node_t *n) {
+  for (; n != NULL; n = n->parent) {
+    if (is_leaf(n))
+      n->clients = n->client != NULL ? 1 : 0;
+    else
+      n->clients = clients_count_in(n->first_child) + clients_count_in(n->second_child);
+  }
 }
 
 int tiled_count(node_t *n, bool include_receptacles) {
@@ -230,6 +335,9 @@ node_t *prev_leaf(node_t *n, node_t *r) {
 }
 
 void arrange(struct bwm_output *m, desktop_t *d, bool use_transaction) {
+  output_sync_desktops(m);
+  d->layout_dirty = false;
+
   if (d->root == NULL) {
     if (use_transaction)
       transaction_commit_dirty();
@@ -474,6 +582,7 @@ void apply_layout(struct bwm_output *m, desktop_t *d, node_t *n, struct wlr_box
       n->first_child = NULL;
       n->second_child = NULL;
       n->parent = NULL;
+      update_clients_count(valid_child);
 
       apply_layout(m, d, valid_child, rect, root_rect);
       return;
@@ -564,11 +673,115 @@ node_t *find_public(desktop_t *d) {
   return b;
 }
 
+bool desktop_is_visible(desktop_t *d) {
+  return d != NULL && (d->output == NULL || d->output->desk == d);
+}
+
+struct wlr_scene_tree *desktop_layer(desktop_t *d, struct wlr_scene_tree *layer) {
+  if (d == NULL)
+    return layer;
+
+  struct wlr_scene_tree **slot = NULL;
+  if (layer == server.tile_tree)
+    slot = &d->tile_tree;
+  else if (layer == server.float_tree)
+    slot = &d->float_tree;
+  else if (layer == server.full_tree)
+    slot = &d->full_tree;
+  if (slot == NULL)
+    return layer;
+
+  if (*slot == NULL) {
+    *slot = wlr_scene_tree_create(layer);
+    if (*slot == NULL)
+      return layer;
+    wlr_scene_node_set_enabled(&(*slot)->node, desktop_is_visible(d));
+  }
+  return *slot;
+}
+
+void desktop_set_visible(desktop_t *d, bool visible) {
+  if (d == NULL)
+    return;
+
+  struct wlr_scene_tree *trees[] = {d->tile_tree, d->float_tree, d->full_tree};
+  bool changed = false;
+  for (size_t i = 0; i < sizeof(trees) / sizeof(trees[0]); i++) {
+    if (trees[i] == NULL || trees[i]->node.enabled == visible)
+      continue;
+    wlr_scene_node_set_enabled(&trees[i]->node, visible);
+    changed = true;
+  }
+
+  if (changed)
+    spatial_invalidate();
+}
+
+void desktop_destroy_layers(desktop_t *d) {
+  if (d == NULL)
+    return;
+
+  struct wlr_scene_tree **slots[] = {&d->tile_tree, &d->float_tree, &d->full_tree};
+  for (size_t i = 0; i < sizeof(slots) / sizeof(slots[0]); i++) {
+    struct wlr_scene_tree *tree = *slots[i];
+    if (tree == NULL)
+      continue;
+
+    // windows still on the desktop fall back to the shared layer
+    struct wlr_scene_node *child, *tmp;
+    wl_list_for_each_safe(child, tmp, &tree->children, link)
+      wlr_scene_node_reparent(child, tree->node.parent);
+
+    wlr_scene_node_destroy(&tree->node);
+    *slots[i] = NULL;
+  }
+}
+
+void output_sync_desktops(struct bwm_output *m) {
+  if (m == NULL)
+    return;
+  for (desktop_t *d = m->desk_head; d != NULL; d = d->next)
+    desktop_set_visible(d, d == m->desk);
+}
+
+// NULL marks the desktops of every output
+void desktops_mark_dirty(struct bwm_output *m) {
+  for (struct bwm_output *o = m ? m : mon_head; o != NULL; o = m ? NULL : o->next)
+    for (desktop_t *d = o->desk_head; d != NULL; d = d->next)
+      d->layout_dirty = true;
+}
+
+void node_reparent_scene(node_t *n) {
+  if (n == NULL || n->client == NULL)
+    return;
+
+  struct wlr_scene_tree *scene_tree = client_get_scene_tree(n->client);
+  if (scene_tree == NULL)
+    return;
+
+  struct wlr_scene_tree *layer = server.tile_tree;
+  if (n->client->state == STATE_FULLSCREEN)
+    layer = server.full_tree;
+  else if (n->client->state == STATE_FLOATING)
+    layer = server.float_tree;
+
+  wlr_scene_node_reparent(&scene_tree->node, desktop_layer(n->desktop, layer));
+}
+
+bool node_on_screen(node_t *n) {
+  if (n == NULL || n->client == NULL || !n->client->shown)
+    return false;
+  return n->desktop == NULL || desktop_is_visible(n->desktop);
+}
+
 node_t *insert_node(desktop_t *d, node_t *n, node_t *f) {
   if (d == NULL || n == NULL)
     return NULL;
 
   n->desktop = d;
+  d->layout_dirty = true;
+  d->shown_synced = false;
+  node_reparent_scene(n);
 
   wlr_log(WLR_DEBUG, "insert_node: n=%u (state=%d hidden=%d parent=%u) f=%u root=%u focus=%u",
     n->id, n->client ? (int)n->client->state : -1, n->hidden,
@@ -602,6 +815,7 @@ node_t *insert_node(desktop_t *d, node_t *n, node_t *f) {
     wlr_log(WLR_DEBUG, "insert_node: empty tree, node %u becomes root", n->id);
     d->root = n;
     n->parent = NULL;
+    update_clients_count(n);
     return f;
   }
 
@@ -617,6 +831,7 @@ node_t *insert_node(desktop_t *d, node_t *n, node_t *f) {
     } else d->root = n;
     n->parent = p;
     free_node(f);
+    update_clients_count(n);
     return NULL;
   }
 
@@ -771,6 +986,8 @@ node_t *insert_node(desktop_t *d, node_t *n, node_t *f) {
     presel_cancel(f);
   }
 
+  update_clients_count(n);
+
   wlr_log(WLR_DEBUG, "insert_node: done, n=%u parent=%u root=%u",
     n->id, n->parent ? n->parent->id : 0, d->root ? d->root->id : 0);
 
@@ -778,10 +995,8 @@ node_t *insert_node(desktop_t *d, node_t *n, node_t *f) {
     wlr_log(WLR_ERROR, "insert_node: post-insert root %u has non-NULL parent %u, tree split detected",
       d->root->id, d->root->parent->id);
 
-  // if new node landed inside tab group, refresh its tab bar
-  node_t *t = tabbed_ancestor(n);
-  if (t != NULL)
-    tabs_rebuild(t);
+  // tab groups containing the new node refresh on the next arrange
+  tabs_mark_ancestors_dirty(n);
 
   return f;
 }
@@ -790,19 +1005,15 @@ void remove_node(desktop_t *d, node_t *n) {
   if (n == NULL || d == NULL)
     return;
 
+  d->layout_dirty = true;
+  d->shown_synced = false;
+
   wlr_log(WLR_DEBUG, "remove_node: node=%u state=%d parent=%u root=%u focus=%u",
     n->id, n->client ? (int)n->client->state : -1,
     n->parent ? n->parent->id : 0,
     d->root ? d->root->id : 0,
     d->focus ? d->focus->id : 0);
 
-  // rebuild tab bar for each tabbed ancestor
-  node_t *tabbed_chain[64];
-  int tabbed_chain_count = 0;
-  for (node_t *q = n->parent; q != NULL && tabbed_chain_count < 64; q = q->parent)
-    if (q->split_type == TYPE_TABBED)
-      tabbed_chain[tabbed_chain_count++] = q;
-
   node_t *p = n->parent;
   bool n_is_first = is_first_child(n);
 
@@ -868,6 +1079,13 @@ void remove_node(desktop_t *d, node_t *n) {
     n->first_child = NULL;
     n->second_child = NULL;
 
+    update_clients_count(g);
+
+    // the detached parent drops its bar, tab groups above it refresh on
+    // the next arrange
+    tabs_destroy(p);
+    tabs_mark_ancestors_dirty(b);
+
     // propagate TYPE_TABBED so remaining leaves stay tabbed
     if (p->split_type == TYPE_TABBED && !is_leaf(b)) {
       b->split_type = TYPE_TABBED;
@@ -930,21 +1148,6 @@ void remove_node(desktop_t *d, node_t *n) {
   if (d->root && d->root->parent != NULL)
     wlr_log(WLR_ERROR, "remove_node: post-remove root %u has non-NULL parent %u, tree split detected",
       d->root->id, d->root->parent->id);
-
-  // cleanup tabs
-  for (int i = 0; i < tabbed_chain_count; i++) {
-    node_t *t = tabbed_chain[i];
-    bool still_in_tree = false;
-    if (d->root != NULL) {
-      for (node_t *q = t; q != NULL; q = q->parent) {
-        if (q == d->root) { still_in_tree = true; break; }
-      }
-    }
-    if (!still_in_tree || is_leaf(t))
-      tabs_destroy(t);
-    else
-      tabs_rebuild(t);
-  }
 }
 
 void close_node(node_t *n) {
@@ -971,26 +1174,53 @@ bool focus_node(struct bwm_output *m, desktop_t *d, node_t *n) {
   if (m == NULL || d == NULL || n == NULL)
     return false;
 
+  node_t *prev = d->focus;
   d->focus = n;
   mon = m;
   server.focused_output = m;
 
   bool is_current_desktop = (m->desk == d);
+
+  // visibility only needs a full pass when the layout changed since the last
+  // one, otherwise every leaf is already in the state the layout wants
+  bool full_sync = !d->shown_synced || d->shown_layout != d->layout ||
+                   prev == NULL || prev->desktop != d;
+  if (is_current_desktop && d->root != NULL && full_sync) {
+    d->shown_synced = true;
+    d->shown_layout = d->layout;
+  }
+
   if (is_current_desktop && d->layout == LAYOUT_MONOCLE && d->root != NULL) {
-    // update visibility state and scene graph for all nodes
-    for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root)) {
-      if (node->client == NULL)
-        continue;
-      bool should_show = (node == n);
-      node->client->shown = should_show;
-      struct wlr_scene_tree *scene_tree = client_get_scene_tree(node->client);
-      if (scene_tree)
-        wlr_scene_node_set_enabled(&scene_tree->node, should_show);
+    if (full_sync) {
+      for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root)) {
+        if (node->client == NULL)
+          continue;
+        bool should_show = (node == n);
+        node->client->shown = should_show;
+        struct wlr_scene_tree *scene_tree = client_get_scene_tree(node->client);
+        if (scene_tree)
+          wlr_scene_node_set_enabled(&scene_tree->node, should_show);
+      }
+    } else {
+      // only the old and new focus swap places. n is shown even when it
+      // already was the focus, remove_node may have handed it over while
+      // it was hidden
+      node_t *pair[2] = {prev != n ? prev : NULL, n};
+      for (int i = 0; i < 2; i++) {
+        if (pair[i] == NULL || pair[i]->client == NULL)
+          continue;
+        bool should_show = (pair[i] == n);
+        pair[i]->client->shown = should_show;
+        struct wlr_scene_tree *scene_tree = client_get_scene_tree(pair[i]->client);
+        if (scene_tree)
+          wlr_scene_node_set_enabled(&scene_tree->node, should_show);
+      }
     }
   } else if (is_current_desktop && d->layout == LAYOUT_SCROLLER && d->root != NULL) {
-    for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root))
-      if (node->client != NULL)
-        node->client->shown = true;
+    if (full_sync)
+      for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root))
+        if (node->client != NULL)
+          node->client->shown = true;
 
     if (n != NULL && n->client != NULL && n->client->toplevel && n->client->toplevel->configured) {
       wlr_log(WLR_DEBUG, "focus_node: scroller layout, triggering arrange for scrolling effect");
@@ -1000,7 +1230,7 @@ bool focus_node(struct bwm_output *m, desktop_t *d, node_t *n) {
     }
   } else if (is_current_desktop) {
     // mark all windows as shown in tiled mode, but only for current desktop
-    if (d->root != NULL)
+    if (d->root != NULL && full_sync)
       for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root))
         if (node->client != NULL)
           node->client->shown = true;
@@ -1031,20 +1261,9 @@ bool focus_node(struct bwm_output *m, desktop_t *d, node_t *n) {
       xwayland_view_set_activated(n->client->xwayland_view, true);
   }
 
-  // update border colors for all visible clients on this desktop
-  if (is_current_desktop && d->root != NULL) {
-    for (node_t *node = first_extrema(d->root); node != NULL; node = next_leaf(node, d->root)) {
-      if (node->client == NULL)
-        continue;
-      if (node->client->toplevel) {
-        update_border_colors(node->client->toplevel->border_tree,
-                            node->client->toplevel->border_rects, node->client);
-      } else if (node->client->xwayland_view) {
-        update_border_colors(node->client->xwayland_view->border_tree,
-                            node->client->xwayland_view->border_rects, node->client);
-      }
-    }
-  }
+  // recolor the previously and newly focused borders
+  if (is_current_desktop)
+    update_focus_borders(d);
 
   // pointer follows focus
   if (pointer_follows_focus && n != NULL && n->client != NULL && !server.focus_from_click) {
@@ -1125,6 +1344,12 @@ void swap_nodes(struct bwm_output *m1, desktop_t *d1, node_t *n1, struct bwm_out
 
   n1->client = c2;
   n2->client = c1;
+  if (c1 != NULL)
+    c1->node = n2;
+  if (c2 != NULL)
+    c2->node = n1;
+  update_clients_count(n1);
+  update_clients_count(n2);
 
   bool tmp_vacant = n1->vacant;
   bool tmp_marked = n1->marked;
@@ -1150,6 +1375,10 @@ void swap_nodes(struct bwm_output *m1, desktop_t *d1, node_t *n1, struct bwm_out
   if (c2 != NULL && c2->toplevel != NULL)
     c2->toplevel->node = n1;
 
+  // visibility follows the leaf, the clients just traded places
+  d1->shown_synced = false;
+  d2->shown_synced = false;
+
   if (n1_focused)
     focus_node(m2, d2, n2);
   if (n2_focused)
@@ -1166,6 +1395,8 @@ bool set_state(struct bwm_output *m, desktop_t *d, node_t *n, client_state_t s)
 
   n->client->last_state = n->client->state;
   n->client->state = s;
+  if (d != NULL)
+    d->shown_synced = false;
 
   arrange(m, d, true);
   return true;
@@ -1502,6 +1733,13 @@ static void parse_color(const char *hex, float *color) {
   color[3] = (float)(hex_digit(hex[6]) * 16 + hex_digit(hex[7])) / 255.0f;
 }
 
+void parse_border_colors(void) {
+  parse_color(normal_border_color, normal_border_rgba);
+  parse_color(active_border_color, active_border_rgba);
+  parse_color(focused_border_color, focused_border_rgba);
+  parse_color(presel_feedback_color, presel_feedback_rgba);
+}
+
 static void get_border_color(client_t *client, float *color) {
   if (!client || border_width == 0) {
     color[0] = color[1] = color[2] = 0.0f;
@@ -1509,7 +1747,7 @@ static void get_border_color(client_t *client, float *color) {
     return;
   }
 
-  const char *color_str;
+  const float *rgba;
   struct bwm_output *m = client->toplevel ? client->toplevel->node->output :
   	client->xwayland_view ? client->xwayland_view->node->output : NULL;
   desktop_t *d = m ? m->desk : NULL;
@@ -1529,21 +1767,18 @@ static void get_border_color(client_t *client, float *color) {
   // check if this client's node has an active preselection
   node_t *n = client->toplevel ? client->toplevel->node :
               client->xwayland_view ? client->xwayland_view->node : NULL;
-  if (n && n->presel) {
-    parse_color(presel_feedback_color, color);
-    return;
-  }
-
   bool is_focused = (d && d->focus && d->focus->client == client);
   bool is_active = (d && d->focus && d->focus->client != NULL);
-  if (is_focused)
-    color_str = focused_border_color;
+  if (n && n->presel)
+    rgba = presel_feedback_rgba;
+  else if (is_focused)
+    rgba = focused_border_rgba;
   else if (is_active)
-    color_str = active_border_color;
+    rgba = active_border_rgba;
   else
-    color_str = normal_border_color;
+    rgba = normal_border_rgba;
 
-  parse_color(color_str, color);
+  memcpy(color, rgba, 4 * sizeof(float));
 }
 
 void create_borders(struct wlr_scene_tree *parent, struct wlr_scene_tree **border_tree,
@@ -1563,13 +1798,10 @@ void create_borders(struct wlr_scene_tree *parent, struct wlr_scene_tree **borde
   if (!*border_tree)
     return;
 
-  float color[4];
-  parse_color(focused_border_color, color);
-
-  rects[0] = wlr_scene_rect_create(*border_tree, 0, border_width, color);
-  rects[1] = wlr_scene_rect_create(*border_tree, 0, border_width, color);
-  rects[2] = wlr_scene_rect_create(*border_tree, border_width, 0, color);
-  rects[3] = wlr_scene_rect_create(*border_tree, border_width, 0, color);
+  rects[0] = wlr_scene_rect_create(*border_tree, 0, border_width, focused_border_rgba);
+  rects[1] = wlr_scene_rect_create(*border_tree, 0, border_width, focused_border_rgba);
+  rects[2] = wlr_scene_rect_create(*border_tree, border_width, 0, focused_border_rgba);
+  rects[3] = wlr_scene_rect_create(*border_tree, border_width, 0, focused_border_rgba);
 }
 
 void destroy_borders(struct wlr_scene_tree **border_tree, struct wlr_scene_rect *rects[4]) {
@@ -1646,6 +1878,45 @@ void update_border_colors(struct wlr_scene_tree *border_tree, struct wlr_scene_r
       wlr_scene_rect_set_color(rects[i], color);
 }
 
+void node_update_border_colors(node_t *n) {
+  if (n == NULL || n->client == NULL)
+    return;
+  if (n->client->toplevel)
+    update_border_colors(n->client->toplevel->border_tree,
+                         n->client->toplevel->border_rects, n->client);
+  else if (n->client->xwayland_view)
+    update_border_colors(n->client->xwayland_view->border_tree,
+                         n->client->xwayland_view->border_rects, n->client);
+}
+
+void desktop_update_border_colors(desktop_t *d) {
+  if (d == NULL || d->root == NULL)
+    return;
+  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root))
+    node_update_border_colors(n);
+}
+
+void update_focus_borders(desktop_t *d) {
+  if (d == NULL)
+    return;
+
+  // unfocused windows only change color when the desktop gains or loses
+  // a focused client, or when the layout toggles borderless monocle
+  bool active = d->focus != NULL && d->focus->client != NULL;
+  if (active != d->border_active || d->border_layout != d->layout) {
+    desktop_update_border_colors(d);
+    d->border_active = active;
+    d->border_layout = d->layout;
+  } else if (d->border_focus != d->focus) {
+    node_update_border_colors(d->border_focus);
+    node_update_border_colors(d->focus);
+  } else {
+    node_update_border_colors(d->focus);
+  }
+
+  d->border_focus = d->focus;
+}
+
 struct bwm_output *output_at(double x, double y) {
   for (struct bwm_output *m = mon_head; m != NULL; m = m->next)
     if (wlr_box_contains_point(&m->rectangle, (int)x, (int)y))
@@ -2,24 +2,33 @@
 #include "server.h"
 #include "types.h"
 #include "output.h"
+#include "toplevel.h"
 #include "tree.h"
 #include "transaction.h"
+#include "xwayland.h"
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <wlr/util/log.h>
 #include <wlr/types/wlr_scene.h>
 
 extern struct bwm_server server;
 
+// capability and state bits from ext-workspace-v1
+#define WS_GROUP_CAP_CREATE_WORKSPACE (1 << 0)
+#define WS_CAP_ACTIVATE (1 << 0)
+#define WS_CAP_DEACTIVATE (1 << 1)
+#define WS_CAP_REMOVE (1 << 2)
+#define WS_CAP_ASSIGN (1 << 3)
+#define WS_STATE_ACTIVE (1 << 0)
+#define WS_STATE_URGENT (1 << 1)
+
 static void handle_workspace_request(struct wl_listener *listener, void *data);
+static void desktop_set_output(desktop_t *d, struct bwm_output *m);
 
-static struct wlr_ext_workspace_handle_v1 *find_workspace_by_name(const char *name) {
-  struct wlr_ext_workspace_handle_v1 *workspace;
-  wl_list_for_each(workspace, &server.workspace_manager->workspaces, link)
-    if (strcmp(workspace->name, name) == 0)
-      return workspace;
-  return NULL;
-}
+// desktops of the last unplugged output, in their old order
+static desktop_t *parked_head = NULL;
+static desktop_t *parked_tail = NULL;
 
 struct desktop_t *find_desktop_by_name(const char *name) {
   if (!name || name[0] == '\0') return NULL;
@@ -34,17 +43,7 @@ struct desktop_t *find_desktop_by_name(const char *name) {
     return NULL;
   }
 
-  struct bwm_output *m = mon_head;
-  while (m != NULL) {
-    desktop_t *d = m->desk_head;
-    while (d != NULL) {
-      if (strcmp(d->name, name) == 0)
-        return d;
-      d = d->next;
-    }
-    m = m->next;
-  }
-  return NULL;
+  return desktop_from_name(NULL, name);
 }
 
 void workspace_init(void) {
@@ -58,236 +57,221 @@ void workspace_init(void) {
   server.workspace_commit.notify = handle_workspace_request;
   wl_signal_add(&server.workspace_manager->events.commit, &server.workspace_commit);
 
-  struct wlr_ext_workspace_group_handle_v1 *group =
-    wlr_ext_workspace_group_handle_v1_create(server.workspace_manager, 0);
-  if (!group) {
-    wlr_log(WLR_ERROR, "Failed to create workspace group");
-    return;
-  }
-
   wlr_log(WLR_INFO, "Workspace manager initialized");
 }
 
-void workspace_sync(void) {
-  if (!server.workspace_manager)
-    return;
-
-  struct wlr_ext_workspace_group_handle_v1 *group = NULL;
-  if (!wl_list_empty(&server.workspace_manager->groups))
-    group = wl_container_of(server.workspace_manager->groups.next, group, link);
-
-  struct wlr_ext_workspace_handle_v1 *workspace, *tmp;
-  wl_list_for_each_safe(workspace, tmp, &server.workspace_manager->workspaces, link)
-    wlr_ext_workspace_handle_v1_destroy(workspace);
-
-  if (!mon_head)
+void workspace_output_add(struct bwm_output *m) {
+  if (!server.workspace_manager || m == NULL)
     return;
 
-  desktop_t *d = mon_head->desk_head;
-  while (d != NULL) {
-    struct wlr_ext_workspace_handle_v1 *workspace =
-      wlr_ext_workspace_handle_v1_create(server.workspace_manager, NULL, 0);
-    if (!workspace) {
-      wlr_log(WLR_ERROR, "Failed to create workspace: %s", d->name);
-      d = d->next;
-      continue;
+  if (m->workspace_group == NULL) {
+    m->workspace_group = wlr_ext_workspace_group_handle_v1_create(
+        server.workspace_manager, WS_GROUP_CAP_CREATE_WORKSPACE);
+    if (!m->workspace_group) {
+      wlr_log(WLR_ERROR, "Failed to create workspace group for %s", m->name);
+      return;
     }
-
-    wlr_ext_workspace_handle_v1_set_name(workspace, d->name);
-    wlr_ext_workspace_handle_v1_set_group(workspace, group);
-
-    d = d->next;
+    m->workspace_group->data = m;
+    if (m->wlr_output)
+      wlr_ext_workspace_group_handle_v1_output_enter(m->workspace_group, m->wlr_output);
   }
 
-  struct wlr_ext_workspace_handle_v1 *active = find_workspace_by_name(mon_head->desk->name);
-  if (active)
-    wlr_ext_workspace_handle_v1_set_active(active, true);
-
-  wlr_log(WLR_INFO, "Workspace manager synced");
+  for (desktop_t *d = m->desk_head; d != NULL; d = d->next)
+    workspace_desktop_add(d);
 }
 
-void workspace_fini(void) {
-  if (!server.workspace_manager)
+void workspace_output_remove(struct bwm_output *m) {
+  if (m == NULL || m->workspace_group == NULL)
     return;
 
-  struct wlr_ext_workspace_handle_v1 *workspace, *tmp;
-  wl_list_for_each_safe(workspace, tmp, &server.workspace_manager->workspaces, link)
-    wlr_ext_workspace_handle_v1_destroy(workspace);
-
-  struct wlr_ext_workspace_group_handle_v1 *group, *tmp_group;
-  wl_list_for_each_safe(group, tmp_group, &server.workspace_manager->groups, link)
-    wlr_ext_workspace_group_handle_v1_destroy(group);
+  wlr_ext_workspace_group_handle_v1_destroy(m->workspace_group);
+  m->workspace_group = NULL;
+}
 
-  wl_list_remove(&server.workspace_commit.link);
+static bool desktop_urgent(desktop_t *d) {
+  if (d->root == NULL)
+    return false;
+  for (node_t *n = first_extrema(d->root); n != NULL; n = next_leaf(n, d->root))
+    if (n->client && n->client->urgent)
+      return true;
+  return false;
 }
 
-void workspace_create_desktop(const char *name) {
-  if (!server.workspace_manager)
+void workspace_desktop_update(desktop_t *d) {
+  if (d == NULL || d->workspace == NULL)
     return;
 
-  if (find_workspace_by_name(name)) {
-    wlr_log(WLR_DEBUG, "Workspace already exists: %s", name);
-    return;
-  }
+  struct wlr_ext_workspace_handle_v1 *workspace = d->workspace;
 
-  struct wlr_ext_workspace_group_handle_v1 *group = NULL;
-  if (!wl_list_empty(&server.workspace_manager->groups))
-    group = wl_container_of(server.workspace_manager->groups.next, group, link);
+  if (workspace->name == NULL || strcmp(workspace->name, d->name) != 0)
+    wlr_ext_workspace_handle_v1_set_name(workspace, d->name);
 
-  struct wlr_ext_workspace_handle_v1 *workspace =
-    wlr_ext_workspace_handle_v1_create(server.workspace_manager, NULL, 0);
-  if (!workspace) {
-    wlr_log(WLR_ERROR, "Failed to create workspace: %s", name);
-    return;
-  }
+  struct wlr_ext_workspace_group_handle_v1 *group =
+    d->output ? d->output->workspace_group : NULL;
+  if (workspace->group != group)
+    wlr_ext_workspace_handle_v1_set_group(workspace, group);
 
-  wlr_ext_workspace_handle_v1_set_name(workspace, name);
-  wlr_ext_workspace_handle_v1_set_group(workspace, group);
-  wlr_ext_workspace_handle_v1_set_hidden(workspace, true);
+  bool active = d->output != NULL && d->output->desk == d;
+  if (((workspace->state & WS_STATE_ACTIVE) != 0) != active)
+    wlr_ext_workspace_handle_v1_set_active(workspace, active);
 
-  wlr_log(WLR_INFO, "Created workspace: %s", name);
+  bool urgent = desktop_urgent(d);
+  if (((workspace->state & WS_STATE_URGENT) != 0) != urgent)
+    wlr_ext_workspace_handle_v1_set_urgent(workspace, urgent);
 }
 
-static void update_window_visibility(node_t *node, struct bwm_output *m, desktop_t *current_desktop, int *count) {
-  if (!node || !node->client)
+void workspace_desktop_add(desktop_t *d) {
+  if (!server.workspace_manager || d == NULL)
     return;
 
-  struct wlr_scene_tree *scene_tree = client_get_scene_tree(node->client);
-  if (!scene_tree)
-    return;
+  if (d->workspace == NULL) {
+    d->workspace = wlr_ext_workspace_handle_v1_create(server.workspace_manager, NULL,
+      WS_CAP_ACTIVATE | WS_CAP_DEACTIVATE | WS_CAP_REMOVE | WS_CAP_ASSIGN);
+    if (!d->workspace) {
+      wlr_log(WLR_ERROR, "Failed to create workspace: %s", d->name);
+      return;
+    }
+    d->workspace->data = d;
+    wlr_log(WLR_INFO, "Created workspace: %s", d->name);
+  }
 
-  (*count)++;
+  workspace_desktop_update(d);
+}
 
-  struct bwm_output *node_mon = node->output;
-  if (!node_mon || node_mon != m)
+void workspace_desktop_remove(desktop_t *d) {
+  if (d == NULL || d->workspace == NULL)
     return;
 
-  bool should_show = false;
-  bool found = false;
-  desktop_t *d = m->desk_head;
-  while (d != NULL) {
-    if (d->root != NULL) {
-      node_t *parent = node;
-      while (parent != NULL) {
-        if (parent == d->root) {
-          // this node belongs to desktop d
-          should_show = (d == current_desktop);
-          found = true;
-          goto found_desktop;
-        }
-        parent = parent->parent;
-      }
-    }
-    d = d->next;
-  }
+  wlr_ext_workspace_handle_v1_destroy(d->workspace);
+  d->workspace = NULL;
+}
+
+void workspace_output_evacuate(struct bwm_output *m) {
+  struct bwm_output *target = NULL;
+  for (struct bwm_output *o = mon_head; o != NULL; o = o->next)
+    if (o != m && (target == NULL || (o->enabled && !target->enabled)))
+      target = o;
 
-  if (!found) {
-    if (node->client && node->client->state == STATE_FLOATING && node->desktop != NULL) {
-      should_show = (node->desktop == current_desktop);
-      found = true;
-    } else {
-      should_show = false;
+  while (m->desk_head != NULL) {
+    desktop_t *d = m->desk_head;
+    output_unlink_desktop(m, d);
+    d->layout_dirty = true;
+
+    if (target != NULL) {
+      output_append_desktop(target, d);
+      desktop_set_output(d, target);
+      workspace_desktop_update(d);
+      wlr_log(WLR_INFO, "Moved desktop %s to %s", d->name, target->name);
+      continue;
     }
-  }
 
-found_desktop:
-  // in monocle layout, only the focused node should be visible
-  if (should_show && current_desktop->layout == LAYOUT_MONOCLE)
-    should_show = (node == current_desktop->focus);
-
-  if (should_show) {
-    node->client->shown = true;
-    bool already_configured = true;
-    if (node->client->toplevel)
-      already_configured = node->client->toplevel->configured;
-    if (already_configured)
-      wlr_scene_node_set_enabled(&scene_tree->node, true);
-  } else {
-    node->client->shown = false;
-    wlr_scene_node_set_enabled(&scene_tree->node, false);
+    // unreachable until adopted, so neither selectors nor bars see it
+    workspace_desktop_remove(d);
+    desktop_unindex(d);
+    desktop_set_output(d, NULL);
+    desktop_set_visible(d, false);
+    d->prev = parked_tail;
+    if (parked_tail)
+      parked_tail->next = d;
+    else
+      parked_head = d;
+    parked_tail = d;
   }
+  m->desk = NULL;
+
+  if (target != NULL)
+    output_sync_desktops(target);
 }
 
-static void update_all_toplevels_visibility(struct bwm_output *m, desktop_t *current_desktop) {
-  int window_count = 0;
+bool workspace_adopt_parked(struct bwm_output *m) {
+  if (parked_head == NULL)
+    return false;
 
-  struct bwm_toplevel *toplevel;
-  wl_list_for_each(toplevel, &server.toplevels, link) {
-    if (!toplevel->mapped || !toplevel->scene_tree || !toplevel->node)
-      continue;
-    update_window_visibility(toplevel->node, m, current_desktop, &window_count);
+  while (parked_head != NULL) {
+    desktop_t *d = parked_head;
+    parked_head = d->next;
+    output_append_desktop(m, d);
+    desktop_set_output(d, m);
+    desktop_index(d);
   }
+  parked_tail = NULL;
 
-  desktop_t *d = m->desk_head;
-  while (d != NULL) {
-    if (d->root != NULL) {
-      node_t *n = first_extrema(d->root);
-      while (n != NULL) {
-        if (n->client && n->client->xwayland_view)
-          update_window_visibility(n, m, current_desktop, &window_count);
-        n = next_leaf(n, d->root);
-      }
-    }
-    d = d->next;
-  }
-
-  struct bwm_xwayland_view *xwayland_view;
-  wl_list_for_each(xwayland_view, &server.xwayland.views, link) {
-    if (!xwayland_view->mapped || !xwayland_view->scene_tree || !xwayland_view->node)
-      continue;
-    if (xwayland_view->node->client && xwayland_view->node->client->state == STATE_FLOATING)
-      update_window_visibility(xwayland_view->node, m, current_desktop, &window_count);
-  }
+  output_sync_desktops(m);
+  wlr_log(WLR_INFO, "Output %s adopted the desktops of the last unplugged output", m->name);
+  return true;
 }
 
-void workspace_switch_to_desktop(const char *name) {
+void workspace_sync(void) {
   if (!server.workspace_manager)
     return;
 
-  struct wlr_ext_workspace_handle_v1 *workspace = find_workspace_by_name(name);
-  if (!workspace) {
-    wlr_log(WLR_ERROR, "Workspace not found: %s", name);
-    return;
-  }
+  for (struct bwm_output *m = mon_head; m != NULL; m = m->next)
+    workspace_output_add(m);
+}
 
-  desktop_t *d = find_desktop_by_name(name);
-  if (!d) {
-    wlr_log(WLR_ERROR, "Desktop not found: %s", name);
+void workspace_fini(void) {
+  if (!server.workspace_manager)
     return;
+
+  for (struct bwm_output *m = mon_head; m != NULL; m = m->next) {
+    for (desktop_t *d = m->desk_head; d != NULL; d = d->next)
+      workspace_desktop_remove(d);
+    workspace_output_remove(m);
   }
 
-  desktop_t *old_desktop = server.focused_output->desk;
+  wl_list_remove(&server.workspace_commit.link);
+}
+
+static void workspace_activate(desktop_t *d) {
+  struct bwm_output *m = d->output ? d->output : server.focused_output;
+  if (m == NULL)
+    return;
 
-  server.focused_output->desk = d;
+  desktop_t *old_desktop = m->desk;
+  m->desk = d;
 
   wlr_log(WLR_DEBUG, "Switching from %s to %s",
           old_desktop ? old_desktop->name : "NULL", d->name);
 
-  struct wlr_ext_workspace_handle_v1 *old = workspace_get_active();
-  if (old)
-    wlr_ext_workspace_handle_v1_set_active(old, false);
-
-  wlr_ext_workspace_handle_v1_set_active(workspace, true);
-  wlr_ext_workspace_handle_v1_set_hidden(workspace, false);
+  // only the state bits of the two desktops involved change
+  workspace_desktop_update(old_desktop);
+  workspace_desktop_update(d);
 
-  update_all_toplevels_visibility(server.focused_output, d);
+  // windows live in their desktop's scene layers, swapping desktops is
+  // just toggling those
+  output_sync_desktops(m);
 
   if (d->root == NULL) {
-    wlr_log(WLR_DEBUG, "Desktop %s has no root, skipping arrange/focus", name);
-    wlr_log(WLR_INFO, "Switched to desktop: %s", name);
+    wlr_log(WLR_DEBUG, "Desktop %s has no root, skipping arrange/focus", d->name);
+    wlr_log(WLR_INFO, "Switched to desktop: %s", d->name);
     return;
   }
 
-  arrange(server.focused_output, d, true);
+  // the layout is still valid from when the desktop was last shown unless
+  // something it depends on changed meanwhile
+  if (d->layout_dirty)
+    arrange(m, d, true);
+  else
+    wlr_log(WLR_DEBUG, "Desktop %s layout unchanged, skipping arrange", d->name);
 
   if (d->focus != NULL)
-    focus_node(server.focused_output, d, d->focus);
+    focus_node(m, d, d->focus);
+
+  wlr_log(WLR_INFO, "Switched to desktop: %s", d->name);
+}
+
+void workspace_switch_to_desktop(const char *name) {
+  desktop_t *d = find_desktop_by_name(name);
+  if (!d) {
+    wlr_log(WLR_ERROR, "Desktop not found: %s", name);
+    return;
+  }
 
-  wlr_log(WLR_INFO, "Switched to desktop: %s", name);
+  workspace_activate(d);
 }
 
 void workspace_switch_to_desktop_by_index(int index) {
-  if (!server.workspace_manager || !server.focused_output)
+  if (!server.focused_output)
     return;
 
   wlr_log(WLR_DEBUG, "Looking for desktop at index %d", index);
@@ -305,18 +289,116 @@ void workspace_switch_to_desktop_by_index(int index) {
   }
 
   wlr_log(WLR_DEBUG, "Switching to desktop: %s", target->name);
-  workspace_switch_to_desktop(target->name);
+  workspace_activate(target);
 }
 
-struct wlr_ext_workspace_handle_v1 *workspace_get_active(void) {
-  if (!server.workspace_manager)
-    return NULL;
+static void create_desktop(const char *name, struct wlr_ext_workspace_group_handle_v1 *group) {
+  struct bwm_output *m = group && group->data ? group->data : server.focused_output;
+  if (m == NULL || name == NULL)
+    return;
+
+  if (desktop_from_name(m, name) != NULL) {
+    wlr_log(WLR_DEBUG, "Workspace already exists: %s", name);
+    return;
+  }
+
+  desktop_t *d = make_desktop(name);
+  if (d == NULL)
+    return;
+  output_append_desktop(m, d);
+  workspace_desktop_add(d);
+}
+
+// show a neighbour instead, an output always shows one of its desktops
+static void deactivate_desktop(desktop_t *d) {
+  struct bwm_output *m = d->output;
+  if (m == NULL || m->desk != d)
+    return;
+
+  desktop_t *other = d->next ? d->next : d->prev;
+  if (other != NULL)
+    workspace_activate(other);
+}
+
+// floating windows stay owned by the desktop outside of its tree, so
+// walk the window lists rather than the tree
+bool desktop_has_windows(desktop_t *d) {
+  if (d->root != NULL)
+    return true;
+
+  struct bwm_toplevel *toplevel;
+  wl_list_for_each(toplevel, &server.toplevels, link)
+    if (toplevel->node && toplevel->node->desktop == d)
+      return true;
+
+  struct bwm_xwayland_view *view;
+  wl_list_for_each(view, &server.xwayland.views, link)
+    if (view->node && view->node->desktop == d)
+      return true;
+
+  return false;
+}
+
+static void desktop_set_output(desktop_t *d, struct bwm_output *m) {
+  struct bwm_toplevel *toplevel;
+  wl_list_for_each(toplevel, &server.toplevels, link)
+    if (toplevel->node && toplevel->node->desktop == d)
+      toplevel->node->output = m;
+
+  struct bwm_xwayland_view *view;
+  wl_list_for_each(view, &server.xwayland.views, link)
+    if (view->node && view->node->desktop == d)
+      view->node->output = m;
+}
+
+static void remove_desktop(desktop_t *d) {
+  struct bwm_output *m = d->output;
+  if (m == NULL || (d->prev == NULL && d->next == NULL)) {
+    wlr_log(WLR_DEBUG, "Not removing the only desktop %s", d->name);
+    return;
+  }
+  if (desktop_has_windows(d)) {
+    wlr_log(WLR_DEBUG, "Not removing desktop %s, it still has windows", d->name);
+    return;
+  }
+
+  bool was_shown = m->desk == d;
+  output_unlink_desktop(m, d);
+  workspace_desktop_remove(d);
+  wlr_log(WLR_INFO, "Removed desktop: %s", d->name);
+  free_desktop(d);
+
+  if (was_shown && m->desk)
+    workspace_activate(m->desk);
+}
+
+static void assign_desktop(desktop_t *d, struct wlr_ext_workspace_group_handle_v1 *group) {
+  struct bwm_output *src = d->output;
+  struct bwm_output *target = group ? group->data : NULL;
+  if (target == NULL || src == NULL || target == src)
+    return;
+  if (d->prev == NULL && d->next == NULL) {
+    wlr_log(WLR_DEBUG, "Not moving the only desktop of %s", src->name);
+    return;
+  }
+
+  output_unlink_desktop(src, d);
+  output_append_desktop(target, d);
+  desktop_set_output(d, target);
+  d->layout_dirty = true;
+
+  output_sync_desktops(src);
+  output_sync_desktops(target);
+  workspace_desktop_update(d);
+
+  if (src->desk) {
+    workspace_desktop_update(src->desk);
+    arrange(src, src->desk, true);
+  }
+  if (target->desk == d)
+    arrange(target, d, true);
 
-  struct wlr_ext_workspace_handle_v1 *workspace;
-  wl_list_for_each(workspace, &server.workspace_manager->workspaces, link)
-    if (workspace->state == 1)
-      return workspace;
-  return NULL;
+  wlr_log(WLR_INFO, "Moved desktop %s to %s", d->name, target->name);
 }
 
 static void handle_workspace_request(struct wl_listener *listener, void *data) {
@@ -326,17 +408,23 @@ static void handle_workspace_request(struct wl_listener *listener, void *data) {
   wl_list_for_each(request, event->requests, link) {
     switch (request->type) {
     case WLR_EXT_WORKSPACE_V1_REQUEST_CREATE_WORKSPACE:
-      workspace_create_desktop(request->create_workspace.name);
+      create_desktop(request->create_workspace.name, request->create_workspace.group);
       break;
     case WLR_EXT_WORKSPACE_V1_REQUEST_ACTIVATE:
-      if (request->activate.workspace)
-        workspace_switch_to_desktop(request->activate.workspace->name);
+      if (request->activate.workspace && request->activate.workspace->data)
+        workspace_activate(request->activate.workspace->data);
       break;
     case WLR_EXT_WORKSPACE_V1_REQUEST_DEACTIVATE:
+      if (request->deactivate.workspace && request->deactivate.workspace->data)
+        deactivate_desktop(request->deactivate.workspace->data);
       break;
     case WLR_EXT_WORKSPACE_V1_REQUEST_ASSIGN:
+      if (request->assign.workspace && request->assign.workspace->data)
+        assign_desktop(request->assign.workspace->data, request->assign.group);
       break;
     case WLR_EXT_WORKSPACE_V1_REQUEST_REMOVE:
+      if (request->remove.workspace && request->remove.workspace->data)
+        remove_desktop(request->remove.workspace->data);
       break;
     }
   }
@@ -10,6 +10,8 @@
 #include "keyboard.h"
 #include "output.h"
 #include "tabs.h"
+#include "spatial.h"
+#include "animation.h"
 #include <float.h>
 #include <stdlib.h>
 #include <string.h>
@@ -438,6 +440,7 @@ void xwayland_view_set_activated(struct bwm_xwayland_view *xwayland_view, bool a
 		// raise scene tree to top
 		if (xwayland_view->scene_tree)
 			wlr_scene_node_raise_to_top(&xwayland_view->scene_tree->node);
+		spatial_invalidate();
 
 		// notify keyboard seat
 		struct wlr_seat *seat = server.seat;
@@ -543,6 +546,7 @@ static void handle_map(struct wl_listener *listener, void *data) {
 	}
 
 	node->client = client;
+	client->node = node;
 	client->toplevel = NULL;
 	client->xwayland_view = xwayland_view;
 	xwayland_view->node = node;
@@ -625,7 +629,8 @@ static void handle_map(struct wl_listener *listener, void *data) {
 
 	bool rule_forces_float = rule && rule->has_state && rule->state == STATE_FLOATING;
 	if (wants_float || rule_forces_float) {
-		wlr_scene_node_reparent(&xwayland_view->scene_tree->node, server.float_tree);
+		wlr_scene_node_reparent(&xwayland_view->scene_tree->node,
+			desktop_layer(target_desktop, server.float_tree));
 		client->floating_rectangle.x = xsurface->x;
 		client->floating_rectangle.y = xsurface->y;
 		client->floating_rectangle.width = xsurface->width;
@@ -656,11 +661,6 @@ static void handle_map(struct wl_listener *listener, void *data) {
 
 	insert_node(target_desktop, node, target_desktop->focus);
 
-	if (target_desktop != d && !target_desktop_is_focused) {
-		client->shown = false;
-		wlr_scene_node_set_enabled(&xwayland_view->scene_tree->node, false);
-	}
-
 	if (should_focus && target_desktop_is_focused)
 		focus_node(target_monitor, target_desktop, node);
 	else if (should_focus && !target_desktop_is_focused)
@@ -713,6 +713,8 @@ static void handle_unmap(struct wl_listener *listener, void *data) {
 	}
 
 	if (xwayland_view->scene_tree) {
+		if (xwayland_view->node)
+			animation_close(xwayland_view->node, xwayland_view->content_tree);
 		wlr_scene_node_set_enabled(&xwayland_view->scene_tree->node, false);
 		wlr_scene_node_set_enabled(&xwayland_view->content_tree->node, false);
 	}
@@ -868,7 +870,7 @@ static void handle_request_fullscreen(struct wl_listener *listener, void *data)
 			wlr_xwayland_surface_set_fullscreen(xsurface, true);
 			return;
 		}
-		wlr_scene_node_reparent(&scene_tree->node, server.full_tree);
+		wlr_scene_node_reparent(&scene_tree->node, desktop_layer(node->desktop, server.full_tree));
 		wlr_xwayland_surface_set_fullscreen(xsurface, true);
 		set_state(m, d, node, STATE_FULLSCREEN);
 	} else {
@@ -956,7 +958,8 @@ static void handle_set_title(struct wl_listener *listener, void *data) {
 	if (xwayland_view->node && xwayland_view->node->client && xsurface->title) {
 		strncpy(xwayland_view->node->client->title, xsurface->title, MAXLEN - 1);
 		xwayland_view->node->client->title[MAXLEN - 1] = '\0';
-		tabs_update_label_for_leaf(xwayland_view->node);
+		xwayland_view->names_dirty = true;
+		toplevel_schedule_names(xwayland_view->node);
 	}
 }
 
@@ -969,7 +972,18 @@ static void handle_set_class(struct wl_listener *listener, void *data) {
 	if (xwayland_view->node && xwayland_view->node->client && xsurface->class) {
 		strncpy(xwayland_view->node->client->app_id, xsurface->class, MAXLEN - 1);
 		xwayland_view->node->client->app_id[MAXLEN - 1] = '\0';
-		tabs_update_label_for_leaf(xwayland_view->node);
+		xwayland_view->names_dirty = true;
+		toplevel_schedule_names(xwayland_view->node);
+	}
+}
+
+void xwayland_flush_names(void) {
+	struct bwm_xwayland_view *view;
+	wl_list_for_each(view, &server.xwayland.views, link) {
+		if (!view->names_dirty)
+			continue;
+		view->names_dirty = false;
+		tabs_update_label_for_leaf(view->node);
 	}
 }
 
@@ -980,10 +994,12 @@ static void handle_set_hints(struct wl_listener *listener, void *data) {
 	struct wlr_xwayland_surface *xsurface = xwayland_view->xwayland_surface;
 
 	if (xwayland_view->node && xwayland_view->node->client) {
-		if (xsurface->hints && (xsurface->hints->flags & XCB_ICCCM_WM_HINT_X_URGENCY))
-			xwayland_view->node->client->urgent = true;
-		else
-			xwayland_view->node->client->urgent = false;
+		client_t *client = xwayland_view->node->client;
+		bool urgent = xsurface->hints && (xsurface->hints->flags & XCB_ICCCM_WM_HINT_X_URGENCY);
+		if (client->urgent != urgent) {
+			client->urgent = urgent;
+			workspace_desktop_update(xwayland_view->node->desktop);
+		}
 	}
 }
 